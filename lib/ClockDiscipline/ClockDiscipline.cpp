@@ -0,0 +1,434 @@
+#include "ClockDiscipline.h"
+#include <RtcCache.h>
+#include <Telemetry.h>
+#include <stddef.h>
+
+namespace ClockDiscipline {
+
+  // What is kept in the DS1307 RAM
+  struct Stored {
+    uint8_t  version;
+    int32_t  driftPpb;      // DS1307 rate error, positive runs fast
+    uint32_t rtcSet;        // UTC the RTC was last set to, 0 unknown
+    uint32_t fitSeconds;    // weight of the drift estimate
+    uint16_t residualPpb;   // smoothed deviation of the fits from it
+    uint8_t  fits;
+    uint8_t  check;
+  };
+  static const uint8_t storedVersion = 1;
+
+  enum Source { RTC, DCF, COARSE };
+
+  static RTC_DS1307 *rtc;
+  static Stored state;
+
+  // The clock: UTC seconds and milliseconds at lastMillis
+  static uint32_t clockSec;
+  static int16_t  clockMs;
+  static uint32_t lastMillis;
+  static int32_t  rateFrac;     // rate correction not applied yet, ms * 1e6
+  static int32_t  ratePpm;      // ATmega oscillator correction
+  static int32_t  pendingMs;    // offset still to slew in
+  static uint16_t slewFrac;     // elapsed ms not yet worth a slew step
+
+  // Offset to the previous reference of the same source, for the rate
+  static bool     rateValid;
+  static uint8_t  rateSource;
+  static int32_t  rateOffset;
+  static uint32_t rateMillis;
+  static int32_t  rateSlewed;   // slewed in since
+
+  // The RTC second edge, found by reading the RTC until its seconds change
+  static bool     phaseKnown;   // edgeMs is where the RTC second starts
+  static int16_t  edgeMs;       // in clock ms, moved along with the slew
+  static int16_t  edgeLo;       // the edge is between these, clock ms,
+  static int16_t  edgeHi;       // moved along with the slew as well
+  static uint8_t  narrowed;     // seconds the bracket was narrowed, 0 none
+  static bool     sampling;
+  static uint32_t sampleSec;    // RTC second at the previous read
+  static uint32_t sampleMillis; // and its millis()
+  static uint32_t trackedSec;   // clock second of the last RTC measurement
+  static uint32_t dcfSec;       // clock second of the last DCF77 reference
+
+  static bool     calibrating;  // measure the RTC against DCF77 for a fit
+  static bool     setPending;   // set the RTC on the next second of UTC
+  static int16_t  lastUtcMs;
+  static uint32_t leapAt;       // UTC of an announced leap second
+  static int16_t  rtcLeapMs;    // counted by the RTC, not by UTC
+
+  static int16_t mod1000(int32_t v)
+  {
+    int32_t r = v % 1000;
+    return r < 0 ? r + 1000 : r;
+  }
+
+  // Clock ms a minus b, -500..499
+  static int16_t msBetween(int16_t a, int16_t b)
+  {
+    return mod1000(a - b + 500) - 500;
+  }
+
+  static uint8_t checksum(const Stored &s)
+  {
+    return RtcCache::nvramCheck(&s, offsetof(Stored, check), 0xA5);
+  }
+
+  static void load(void)
+  {
+    rtc->readnvram((uint8_t *)&state, sizeof(state), DisciplineNvramAddress);
+    if (state.version != storedVersion || state.check != checksum(state)) {
+      memset(&state, 0, sizeof(state));
+      state.version = storedVersion;
+    }
+  }
+
+  static void save(void)
+  {
+    state.check = checksum(state);
+    rtc->writenvram(DisciplineNvramAddress, (const uint8_t *)&state, sizeof(state));
+  }
+
+  // How far the RTC has run ahead of UTC since it was set, ms
+  static int32_t rtcAheadMs(uint32_t rtcSec)
+  {
+    if (state.rtcSet == 0) return 0;
+    return (int64_t)(int32_t)(rtcSec - state.rtcSet) * state.driftPpb / 1000000;
+  }
+
+  static void addMs(int32_t ms)
+  {
+    int32_t t = clockMs + ms;
+    int32_t s = t / 1000;
+    t %= 1000;
+    if (t < 0) {
+      t += 1000;
+      s--;
+    }
+    clockSec += s;
+    clockMs = t;
+  }
+
+  // Advance the clock to millis(), rate corrected, and slew in what is
+  // allowed of the pending offset. Called every ms or so: the common case
+  // is one int32 multiply and add, no division
+  static void fold(void)
+  {
+    uint32_t m = millis();
+    uint32_t elapsed = m - lastMillis;
+    if (elapsed == 0) return;
+    lastMillis = m;
+    int32_t ms = elapsed;
+    if (elapsed < 100000UL) {
+      // elapsed * DisciplineMaxRatePpm stays below 2^31
+      int32_t frac = rateFrac + (int32_t)elapsed * ratePpm;
+      if (frac >= 1000000L || frac <= -1000000L) {
+        ms += frac / 1000000L;
+        frac %= 1000000L;
+      }
+      rateFrac = frac;
+    } else {
+      int64_t frac = rateFrac + (int64_t)elapsed * ratePpm;
+      ms += (int32_t)(frac / 1000000);
+      rateFrac = frac % 1000000;
+    }
+
+    int32_t slew = 0;
+    if (pendingMs != 0) {
+      uint32_t slewable = slewFrac + elapsed;
+      int32_t allowance = slewable / DisciplineSlewDiv;
+      slewFrac = slewable % DisciplineSlewDiv;
+      slew = pendingMs > allowance ? allowance : (pendingMs < -allowance ? -allowance : pendingMs);
+    } else {
+      slewFrac = 0;
+    }
+    // Never backwards, not even by a millisecond
+    if (ms + slew < 0) slew = -ms;
+    pendingMs -= slew;
+    rateSlewed += slew;
+    if (phaseKnown) {
+      edgeMs = mod1000(edgeMs + slew);
+      edgeLo = mod1000(edgeLo + slew);
+      edgeHi = mod1000(edgeHi + slew);
+    }
+    addMs(ms + slew);
+    if (leapAt && clockSec >= leapAt) {
+      clockSec--;
+      leapAt = 0;
+      if (state.rtcSet != 0 && !setPending) {
+        calibrating = true;
+        rtcLeapMs = 1000;
+      }
+    }
+  }
+
+  // offset: reference minus clock, ms
+  static void steer(int32_t offset, uint8_t source)
+  {
+    TELEMETRY_EVENT(TelemetryOffset, source, offset);
+    uint32_t m = millis();
+    bool sameSource = rateValid && rateSource == source;
+    if (source != COARSE && sameSource && m - rateMillis >= 10000UL) {
+      // What the oscillator lost against the reference, apart from the slew
+      int32_t lost = offset - rateOffset + rateSlewed;
+      int32_t ppm = ratePpm + (int32_t)((int64_t)lost * 1000000 / (int32_t)(m - rateMillis) / 2);
+      ratePpm = constrain(ppm, -DisciplineMaxRatePpm, DisciplineMaxRatePpm);
+    }
+    if (!sameSource || m - rateMillis >= 10000UL) {
+      rateValid = source != COARSE;
+      rateSource = source;
+      rateOffset = offset;
+      rateMillis = m;
+      rateSlewed = 0;
+    }
+    if (offset > DisciplineStepMs || offset < -DisciplineStepMs) {
+      addMs(offset);
+      pendingMs = 0;
+      rateValid = false;
+      phaseKnown = false;
+    } else {
+      pendingMs = offset;
+    }
+  }
+
+  // A seconds count far from the clock is taken as it is; d is that
+  // count minus the clock's
+  static int32_t near(int32_t d)
+  {
+    if (d > 1000 || d < -1000) {
+      clockSec += d;
+      pendingMs = 0;
+      rateValid = false;
+      phaseKnown = false;
+      return 0;
+    }
+    return d;
+  }
+
+  static void fit(int32_t errMs, uint32_t elapsed)
+  {
+    if (elapsed < DisciplineFitSeconds / 2) return;
+    int32_t measured = (int64_t)errMs * 1000000 / (int32_t)elapsed;
+    if (state.fits == 0) {
+      state.driftPpb = measured;
+      state.fitSeconds = elapsed;
+    } else {
+      uint32_t weight = state.fitSeconds + elapsed;
+      if (weight > DisciplineFitWindow) weight = DisciplineFitWindow;
+      int32_t dev = measured - state.driftPpb;
+      uint32_t absDev = dev < 0 ? -dev : dev;
+      if (absDev > 0xFFFF) absDev = 0xFFFF;
+      state.driftPpb += (int64_t)dev * elapsed / weight;
+      if (state.fits == 1) {
+        state.residualPpb = absDev;
+      } else {
+        state.residualPpb += ((int32_t)absDev - state.residualPpb) * (int64_t)elapsed / weight;
+      }
+      state.fitSeconds = weight;
+    }
+    if (state.fits < 255) state.fits++;
+    TELEMETRY_EVENT(TelemetryDrift, state.fits, state.driftPpb);
+  }
+
+  // Set the RTC on the first call after UTC, the clock plus what is still
+  // to slew in, passed a whole second
+  static void setRtc(uint32_t sec, uint16_t ms)
+  {
+    int32_t utcMs = ms + pendingMs;
+    int16_t u = mod1000(utcMs);
+    if (u >= lastUtcMs) {
+      lastUtcMs = u;
+      return;
+    }
+    uint32_t utc = sec + (utcMs - u) / 1000;
+    RtcCache::write(utc);
+    TELEMETRY_EVENT(TelemetryRtcSet, 0, utc);
+    state.rtcSet = utc;
+    save();
+    setPending = false;
+    // Its second starts now, u ms late
+    edgeMs = mod1000(ms - u);
+    phaseKnown = true;
+    narrowed = 0;
+    trackedSec = sec;
+  }
+
+  // The RTC second changed between the previous read and this one, gapMs
+  // apart; sec and ms are the clock after this read. Reads further apart
+  // than DisciplinePreciseMs are kept as a bracket, which the reads of the
+  // next seconds narrow, as the calls fall at other times in the second
+  static void rtcEdge(uint32_t rtcSec, uint32_t sec, uint16_t ms, uint32_t gapMs)
+  {
+    if (!phaseKnown || gapMs > DisciplineWindowMs) narrowed = 0;
+    int16_t lo = mod1000(ms - (int32_t)gapMs);
+    int16_t hi = ms;
+    if (narrowed) {
+      // Both brackets relative to the expected edge, which is in both
+      int16_t oldLo = msBetween(edgeLo, edgeMs), oldHi = msBetween(edgeHi, edgeMs);
+      int16_t newLo = msBetween(lo, edgeMs), newHi = msBetween(hi, edgeMs);
+      if (newLo < oldLo) newLo = oldLo;
+      if (newHi > oldHi) newHi = oldHi;
+      if (newLo < newHi) {
+        lo = mod1000(edgeMs + newLo);
+        hi = mod1000(edgeMs + newHi);
+      } else {
+        // The edge moved away: start over from this pair of reads
+        narrowed = 0;
+      }
+    }
+    uint16_t width = mod1000(hi - lo);
+    int16_t at = mod1000(lo + width / 2);
+    edgeLo = lo;
+    edgeHi = hi;
+    edgeMs = at;
+    phaseKnown = true;
+    // Reads too far apart only tell where to look next time
+    if (gapMs > DisciplineWindowMs) return;
+    if (width > DisciplinePreciseMs && ++narrowed < DisciplineNarrowSeconds) return;
+    narrowed = 0;
+    uint16_t since = mod1000(ms - at);
+    uint32_t edgeSec = ms >= since ? sec : sec - 1;
+    int32_t d = rtcSec - edgeSec;
+    if (calibrating) {
+      // The RTC against UTC, which is the clock plus the pending slew
+      if (d > -1000 && d < 1000) {
+        int32_t err = d * 1000L - at - pendingMs - rtcLeapMs;
+        TELEMETRY_EVENT(TelemetryRtcError, 0, err);
+        fit(err, rtcSec - state.rtcSet);
+      }
+      rtcLeapMs = 0;
+      calibrating = false;
+      setPending = true;
+      lastUtcMs = mod1000(ms + pendingMs);
+    } else {
+      d = near(d);
+      steer(d * 1000L - at - rtcAheadMs(rtcSec), RTC);
+      trackedSec = sec;
+    }
+  }
+
+  void begin(RTC_DS1307 &r)
+  {
+    rtc = &r;
+    load();
+    // A stopped RTC lost its time, the drift still holds
+    if (!RtcCache::running()) state.rtcSet = 0;
+    ratePpm = 0;
+    resume();
+  }
+
+  void resume(void)
+  {
+    uint32_t sec = RtcCache::read();
+    lastMillis = millis();
+    clockSec = sec;
+    clockMs = 0;
+    rateFrac = 0;
+    slewFrac = 0;
+    addMs(-rtcAheadMs(sec));
+    pendingMs = 0;
+    rateValid = false;
+    phaseKnown = false;
+    sampling = false;
+    calibrating = false;
+    setPending = false;
+    leapAt = 0;
+    rtcLeapMs = 0;
+    trackedSec = clockSec - DisciplineTrackSeconds;
+  }
+
+  time_t now(uint16_t *ms)
+  {
+    fold();
+    if (ms) *ms = clockMs;
+    return clockSec;
+  }
+
+  void reference(time_t utc, uint32_t sinceSecondUs, bool precise)
+  {
+    fold();
+    int32_t d = near(utc - clockSec);
+    if (precise) {
+      steer(d * 1000L + (int32_t)(sinceSecondUs / 1000) - clockMs, DCF);
+    } else {
+      // UTC is somewhere in that second: only whole seconds are corrected
+      int32_t offset = d * 1000L + 500 - clockMs;
+      if (offset > 500 || offset < -500) steer(offset, COARSE);
+    }
+    dcfSec = clockSec;
+    if (!precise || calibrating || setPending) return;
+    if (state.rtcSet == 0) {
+      setPending = true;
+      lastUtcMs = mod1000(clockMs + pendingMs);
+    } else if ((uint32_t)(utc - state.rtcSet) >= DisciplineFitSeconds) {
+      calibrating = true;
+    }
+  }
+
+  void track(void)
+  {
+    uint16_t ms;
+    uint32_t sec = now(&ms);
+    if (setPending) {
+      setRtc(sec, ms);
+      return;
+    }
+    bool held = dcfSec != 0 && sec - dcfSec < DisciplineHoldSeconds;
+    if (!calibrating && (held || sec - trackedSec < DisciplineTrackSeconds)) {
+      sampling = false;
+      return;
+    }
+    if (phaseKnown) {
+      // Only read around the expected edge
+      int16_t toEdge = mod1000(edgeMs - ms);
+      // Start well ahead of it, or wait for the next one
+      if (!sampling && (toEdge > DisciplineWindowMs || toEdge < DisciplineWindowMs / 2)) return;
+      if (toEdge > DisciplineWindowMs && toEdge < 1000 - DisciplineWindowMs) {
+        if (sampling) {
+          // The window passed without an edge: search the whole second
+          sampling = false;
+          phaseKnown = false;
+          narrowed = 0;
+        }
+        return;
+      }
+    } else if (sampling && lastMillis - sampleMillis < DisciplineSearchMs) {
+      return;
+    }
+    uint32_t rtcSec = RtcCache::readSeconds();
+    if (rtcSec == 0) return;
+    sec = now(&ms);
+    if (sampling && rtcSec != sampleSec) {
+      sampling = false;
+      rtcEdge(rtcSec, sec, ms, lastMillis - sampleMillis);
+      return;
+    }
+    sampling = true;
+    sampleSec = rtcSec;
+    sampleMillis = lastMillis;
+  }
+
+  void leapSecond(time_t at)
+  {
+    fold();
+    if (at > clockSec && at - clockSec <= SECS_PER_HOUR) leapAt = at;
+  }
+
+  int32_t driftPpb(void)
+  {
+    return state.driftPpb;
+  }
+
+  uint16_t residualPpb(void)
+  {
+    return state.residualPpb;
+  }
+
+  uint32_t syncGap(void)
+  {
+    if (state.fits < 2) return 0;
+    uint32_t uncertainty = state.residualPpb;
+    if (uncertainty < DisciplineMinResidualPpb) uncertainty = DisciplineMinResidualPpb;
+    uint32_t gap = DisciplineMaxErrorMs * 1000000UL / uncertainty;
+    return gap < DisciplineMaxGap ? gap : DisciplineMaxGap;
+  }
+}
@@ -0,0 +1,78 @@
+#ifndef CLOCKDISCIPLINE_h
+#define CLOCKDISCIPLINE_h
+
+#include <Arduino.h>
+#include <Time.h>
+#include <RTClib.h>
+
+/*
+  Disciplined software clock on top of the DS1307.
+
+  The clock counts UTC in milliseconds from millis(), corrected by the
+  learned rate of the ATmega oscillator. It never steps for small errors:
+  an offset is slewed in at no more than 1/DisciplineSlewDiv of the
+  elapsed time (50 ms per second), so the displayed seconds stay regular.
+
+  References, in order of preference:
+  - DCF77, reference(): the clock is steered to it. Every
+    DisciplineFitSeconds the DS1307 error against it is measured, the
+    drift of the DS1307 fitted, and the RTC set on the second edge.
+  - The DS1307, track(): between syncs the RTC second edge is located by
+    reading the RTC around its expected time, one read per call, and the
+    RTC reading is corrected by the fitted drift since it was set. When
+    the calls are further apart than DisciplinePreciseMs, the reads of
+    successive seconds narrow down the edge for up to
+    DisciplineNarrowSeconds, then the middle of what is left counts.
+
+  The RTC time registers go through RtcCache; while polling for the edge
+  only the seconds register is read.
+
+  The drift (in ppb, positive runs fast), the time the RTC was set and the
+  quality of the fit survive power loss in the DS1307 battery-backed RAM.
+  From the fit follows syncGap(): how long the clock stays within
+  DisciplineMaxErrorMs without DCF77, so receptions can be spaced out.
+*/
+
+#define DisciplineNvramAddress   0
+#define DisciplineNvramBytes     24       // reserved there, SyncState follows
+#define DisciplineSlewDiv        20       // slew rate limit, 1/20 = 50 ms/s
+#define DisciplineStepMs         2000     // larger offsets are stepped
+#define DisciplineMaxRatePpm     20000    // ATmega oscillator correction limit
+#define DisciplineTrackSeconds   10       // RTC edge measurement interval
+#define DisciplineWindowMs       50       // reads around the expected edge
+#define DisciplineSearchMs       8        // read interval while searching
+#define DisciplinePreciseMs      10       // reads this close measure the edge
+#define DisciplineNarrowSeconds  5        // else the bracket is narrowed this long
+#define DisciplineHoldSeconds    300      // DCF77 preferred for this long
+#define DisciplineFitSeconds     21600UL  // min. time between drift fits
+#define DisciplineFitWindow      1209600UL  // memory of the drift fit, 14 days
+#define DisciplineMaxErrorMs     500      // error budget for syncGap()
+#define DisciplineMinResidualPpb 200      // floor of the drift uncertainty
+#define DisciplineMaxGap         604800UL // 7 days
+
+namespace ClockDiscipline {
+  // Load the drift and seed the clock from the RTC
+  void begin(RTC_DS1307 &rtc);
+  // Reseed from the RTC after millis() stood still (power-down)
+  void resume(void);
+
+  // Disciplined UTC, optionally with the milliseconds
+  time_t now(uint16_t *ms = NULL);
+
+  // DCF77 time at this moment: utc plus sinceSecondUs when precise,
+  // otherwise the whole second only
+  void reference(time_t utc, uint32_t sinceSecondUs, bool precise);
+  // A leap second is inserted before UTC at: the clock repeats the second
+  // before it, and the RTC, which counted it, is measured and set again
+  void leapSecond(time_t at);
+  // Follow the RTC while DCF77 is not around, and measure and set it
+  // after a reference; call every ms or so, it never waits for the RTC
+  void track(void);
+
+  int32_t  driftPpb(void);
+  uint16_t residualPpb(void);
+  // Seconds the clock can go without DCF77, 0 while the drift is unknown
+  uint32_t syncGap(void);
+}
+
+#endif
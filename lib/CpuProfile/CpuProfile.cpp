@@ -0,0 +1,71 @@
+#include "CpuProfile.h"
+
+#ifdef CPU_PROFILE
+
+namespace CpuProfile {
+
+  static Counter counters[PROFILE_SECTIONS];
+  static uint32_t windowStart;
+
+  static const char *const names[PROFILE_SECTIONS] = {
+    "isr", "process", "write", "command", "rtc", "loop"
+  };
+
+  // Each section is only ever recorded from one context (the DCF77
+  // interrupt or the main loop), so only readers need interrupts off
+  void record(uint8_t section, uint32_t duration)
+  {
+    Counter &c = counters[section];
+    if (c.count != 0xFFFFFFFFUL) c.count++;
+    uint32_t total = c.totalMicros + duration;
+    c.totalMicros = total < duration ? 0xFFFFFFFFUL : total;
+    if (duration > c.maxMicros) c.maxMicros = duration;
+  }
+
+  void read(uint8_t section, Counter &counter)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    counter = counters[section];
+    SREG = sreg;
+  }
+
+  void reset(void)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    memset(counters, 0, sizeof(counters));
+    windowStart = millis();
+    SREG = sreg;
+  }
+
+  void report(Print &out)
+  {
+    uint32_t window = millis() - windowStart;
+    Counter c[PROFILE_SECTIONS];
+    for (uint8_t i = 0; i < PROFILE_SECTIONS; i++) read(i, c[i]);
+    reset();
+
+    out.print(F("cpu "));
+    out.print(window);
+    out.println(F(" ms"));
+    for (uint8_t i = 0; i < PROFILE_SECTIONS; i++) {
+      out.print(names[i]);
+      out.print(' ');
+      out.print(c[i].count);
+      out.print(' ');
+      out.print(c[i].count ? c[i].totalMicros / c[i].count : 0);
+      out.print('/');
+      out.print(c[i].maxMicros);
+      out.print(F(" us "));
+      // us per ms of window is the share in tenths of a percent
+      uint32_t share = window ? c[i].totalMicros / window : 0;
+      out.print(share / 10);
+      out.print('.');
+      out.print(share % 10);
+      out.println('%');
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CPUPROFILE_h
+#define CPUPROFILE_h
+
+#include <Arduino.h>
+
+/*
+  Where the clock spends its CPU time (compile with -D CPU_PROFILE).
+
+  Each section keeps a call count, the accumulated and the longest
+  duration, measured with micros() (4 us resolution on a 16 MHz AVR).
+  Sections nest: the loop section includes everything the loop calls.
+
+    PROFILE_SCOPE(PROFILE_LOOP);   // times the rest of the enclosing block
+
+  CpuProfile::report() prints the window since the previous report, one
+  line per section, and starts a new window:
+
+    cpu 60012 ms
+    isr 3021 9/48 us 0.0%         calls, mean/max, share of the window
+    ...
+
+  The firmware prints it when 'p' arrives on Serial.
+
+  Without CPU_PROFILE the macro expands to nothing and no counters exist.
+*/
+
+enum {
+  PROFILE_DCF_ISR,          // DCF77::int0handler / sampleHandler
+  PROFILE_DCF_PROCESS,      // DCF77::processBuffer
+  PROFILE_DISPLAY_WRITE,    // FidelioDisplay::write
+  PROFILE_DISPLAY_COMMAND,  // FidelioDisplay::sendCommand
+  PROFILE_RTC_NOW,          // DS1307 time register reads (RtcCache)
+  PROFILE_LOOP,             // the tasks of one loop() pass, not the idle sleep
+  PROFILE_SECTIONS
+};
+
+#ifdef CPU_PROFILE
+
+namespace CpuProfile {
+  struct Counter {
+    uint32_t count;
+    uint32_t totalMicros;   // saturates after 71 min of CPU time per window
+    uint32_t maxMicros;
+  };
+
+  void record(uint8_t section, uint32_t duration);
+  void read(uint8_t section, Counter &counter);
+  void report(Print &out);
+  void reset(void);
+
+  class Scope {
+  public:
+    Scope(uint8_t section) : _section(section), _start(micros()) {}
+    ~Scope() { record(_section, micros() - _start); }
+  private:
+    uint8_t  _section;
+    uint32_t _start;
+  };
+}
+
+#define PROFILE_SCOPE(section) CpuProfile::Scope profileScope(section)
+
+#else
+
+#define PROFILE_SCOPE(section)
+
+#endif
+
+#endif
@@ -24,18 +24,27 @@
 #include <DCF77.h>       //https://github.com/thijse/Arduino-Libraries/downloads
 #include <Time.h>        //http://playground.arduino.cc/code/time
 #include <Utils.h>
+#include <Capture.h>
+#include <FrameDecode.h>
+#include <Accumulator.h>
+#include <SecondTracker.h>
+#include <PulseClassifier.h>
+#include <SampleTimer.h>
+#include <Sampler.h>
+#include <SignalQuality.h>
+#include <CpuProfile.h>
 
 #define _DCF77_VERSION 1_0_0 // software version of this library
 
 using namespace Utils;
 
-char DCF77::lastBit;
-bool DCF77::bufOk;
+DCF77 *DCF77::receivers[DCFMaxReceivers];
 
 /**
  * Constructor
  */
 DCF77::DCF77(int DCF77Pin, int DCFinterrupt, bool OnRisingFlank) 
+	: initialized(false)
 {
 	dCF77Pin     = DCF77Pin;
 	dCFinterrupt = DCFinterrupt;	
@@ -48,31 +57,106 @@ DCF77::DCF77(int DCF77Pin, int DCFinterrupt, bool OnRisingFlank)
 	initialized = true;
 }
 
+DCF77::~DCF77()
+{
+	Stop();
+}
+
 /**
  * Initialize parameters
  */
 void DCF77::initialize(void) 
 {	
 	leadingEdge           = 0;
+	leadingEdgeMicros     = 0;
 	trailingEdge          = 0;
 	PreviousLeadingEdge   = 0;
+	bitTick               = 0;
 	Up                    = false;
+	lastBit               = 0;
+	bufOk                 = false;
 	runningBuffer		  = 0;
-	FilledBufferAvailable = false;
+	processingBuffer      = 0;
+	processingTick        = 0;
+	latestTick            = 0;
+	frameHead             = 0;
+	frameTail             = 0;
+	droppedFrames         = 0;
+	processingQueue       = false;
+	frameHandler          = NULL;
 	bufferPosition        = 0;
-	flags.parityDate      = 0;
-	flags.parityFlag      = 0;
-	flags.parityHour      = 0;
-	flags.parityMin       = 0;
+	frameHole             = DCFNoHole;
+	markerKnown           = false;
+	markerTick            = 0;
+	markerMisses          = DCFMarkerMisses;
 	CEST				  = 0;
+	flags                 = 0;
+	previousFlags         = 0;
+	latestupdatedTime     = 0;
+	previousUpdatedTime   = 0;
+	processingTimestamp   = 0;
+	previousProcessingTimestamp = 0;
+	phaseUTC              = 0;
+	phaseTick             = 0;
+	restoredUTC           = 0;
+	tracker.reset();
+	classifier.reset();
+	stats.reset();
+#ifdef DCF_SAMPLED
+	sampler.reset();
+#endif
+#ifdef DCF_ACCUMULATOR
+	accumulator.reset();
+#endif
 }
 
+/**
+ * Interrupt entry points: attachInterrupt() takes a plain function, these
+ * pass the interrupt on to the receiver started for it
+ */
+void DCF77::int0trampoline(void)
+{
+	receivers[0]->int0handler();
+}
+
+void DCF77::int1trampoline(void)
+{
+	receivers[1]->int0handler();
+}
+
+#ifdef DCF_SAMPLED
+void DCF77::sampleTrampoline(void)
+{
+	for (uint8_t i = 0; i < DCFMaxReceivers; i++) {
+		if (receivers[i]) receivers[i]->sampleHandler();
+	}
+}
+#endif
+
 /**
  * Start receiving DCF77 information
  */
 void DCF77::Start(void) 
 {
-	attachInterrupt(dCFinterrupt, int0handler, CHANGE);
+	if (dCFinterrupt < 0 || dCFinterrupt >= DCFMaxReceivers) {
+		return;
+	}
+#ifdef DCF_CAPTURE
+	if (dCFinterrupt == 0) Capture::begin(millis());
+#endif
+#ifdef DCF_SAMPLED
+	bool timerRunning = false;
+	for (uint8_t i = 0; i < DCFMaxReceivers; i++) {
+		if (receivers[i]) timerRunning = true;
+	}
+	uint8_t sreg = intDisable();
+	receivers[dCFinterrupt] = this;
+	intRestore(sreg);
+	if (!timerRunning) SampleTimer::begin(DCFSampleRate, sampleTrampoline);
+#else
+	receivers[dCFinterrupt] = this;
+	attachInterrupt(dCFinterrupt, dCFinterrupt == 0 ? int0trampoline : int1trampoline, CHANGE);
+#endif
 }
 
 /**
@@ -80,7 +164,22 @@ void DCF77::Start(void)
  */
 void DCF77::Stop(void) 
 {
+	if (dCFinterrupt < 0 || dCFinterrupt >= DCFMaxReceivers || receivers[dCFinterrupt] != this) {
+		return;
+	}
+#ifdef DCF_SAMPLED
+	uint8_t sreg = intDisable();
+	receivers[dCFinterrupt] = NULL;
+	intRestore(sreg);
+	bool timerNeeded = false;
+	for (uint8_t i = 0; i < DCFMaxReceivers; i++) {
+		if (receivers[i]) timerNeeded = true;
+	}
+	if (!timerNeeded) SampleTimer::end();
+#else
 	detachInterrupt(dCFinterrupt);	
+	receivers[dCFinterrupt] = NULL;
+#endif
 }
 
 /**
@@ -90,6 +189,7 @@ inline void DCF77::bufferinit(void)
 {
 	runningBuffer    = 0;
 	bufferPosition   = 0;
+	frameHole        = DCFNoHole;
 }
 
 /**
@@ -97,86 +197,269 @@ inline void DCF77::bufferinit(void)
  */
 
 void DCF77::int0handler() {
-	int flankTime = millis();
+	PROFILE_SCOPE(PROFILE_DCF_ISR);
+	uint32_t flankMicros = micros();
+	uint32_t flankTime = millis();
 	byte sensorValue = digitalRead(dCF77Pin);
+#ifdef DCF_CAPTURE
+	// The time the decoder works with, so a replay decodes the same
+	if (dCFinterrupt == 0) Capture::record(flankTime, sensorValue);
+#endif
 
-	// If flank is detected quickly after previous flank up
-	// this will be an incorrect pulse that we shall reject
-	if ((flankTime-PreviousLeadingEdge)<DCFRejectionTime) {
-		LogLn("rCT");
-		lastBit = 2;
-		bufOk = false;
-		return;
-	}
-	
-	// If the detected pulse is too short it will be an
-	// incorrect pulse that we shall reject as well
-	if ((flankTime-leadingEdge)<DCFRejectPulseWidth) {
-	    LogLn("rPW");
-		lastBit = 3;
-		bufOk = false;
-		return;
-	}
-	
 	if(sensorValue==pulseStart) {
+		// If flank is detected quickly after previous flank up
+		// this will be an incorrect pulse that we shall reject
+		if ((flankTime-PreviousLeadingEdge)<classifier.minGap()) {
+			LogLn("rCT");
+			stats.reject(QualityMinGap);
+			lastBit = 2;
+			bufOk = false;
+			return;
+		}
 		if (!Up) {
 			// Flank up
 			leadingEdge=flankTime;
+			leadingEdgeMicros=flankMicros;
 			Up = true;		                
 		} 
 	} else {
 		if (Up) {
 			// Flank down
 			trailingEdge=flankTime;
-			int difference=trailingEdge - leadingEdge;            
-          		
-			if ((leadingEdge-PreviousLeadingEdge) > DCFSyncTime) {
-				finalizeBuffer();
-			}         
-			PreviousLeadingEdge = leadingEdge;       
-			// Distinguish between long and short pulses
-			if (difference < DCFSplitTime) { appendSignal(0); } else { appendSignal(1); }
 			Up = false;	 
+			uint32_t difference=trailingEdge - leadingEdge;            
+			stats.width(difference > 0xFFFF ? 0xFFFF : difference);
+			int8_t signal = classifier.pulse(difference > 0xFFFF ? 0xFFFF : difference);
+			if (signal == PulseInverted) {
+				// Receiver delivers inverted pulses, swap what counts as the start
+				LogLn("inv");
+				pulseStart = (pulseStart == HIGH) ? LOW : HIGH;
+				bufferinit();
+				markerKnown = false;
+				return;
+			}
+			if (signal == PulseReject) {
+				// Spike or pulse outside of the learned widths; forget its
+				// leading edge so the next real pulse is seen
+				LogLn("rPW");
+				stats.reject(QualityWidth);
+				lastBit = 3;
+				bufOk = false;
+				return;
+			}
+			acceptPulse(signal);
 		}
 	}  
 }
 
+#ifdef DCF_SAMPLED
+/**
+ * Timer interrupt handler of the sampled engine: one pin sample, constant
+ * work however noisy the signal is
+ */
+void DCF77::sampleHandler() {
+	PROFILE_SCOPE(PROFILE_DCF_ISR);
+	uint32_t sampleTime = millis();
+	byte sensorValue = digitalRead(dCF77Pin);
+#ifdef DCF_CAPTURE
+	static byte capturedValue = LOW;
+	if (dCFinterrupt == 0 && sensorValue != capturedValue) {
+		capturedValue = sensorValue;
+		Capture::record(sampleTime, sensorValue);
+	}
+#endif
+	int8_t signal = sampler.sample(sensorValue == pulseStart, classifier, stats);
+	if (signal == SampleIdle || signal == SampleNoPulse) {
+		return;
+	}
+	if (signal == PulseReject) {
+		LogLn("rPW");
+		stats.reject(QualityWidth);
+		lastBit = 3;
+		bufOk = false;
+		return;
+	}
+	leadingEdgeMicros = sampler.secondMicros();
+	leadingEdge = sampleTime - (micros() - leadingEdgeMicros) / 1000;
+	acceptPulse(signal);
+}
+#endif
+
+/**
+ * A pulse (leadingEdge) has been classified: it starts a second and, after
+ * a long enough gap, a new minute
+ */
+inline void DCF77::acceptPulse(unsigned char signal) {
+	uint32_t edgeTick = tracker.edge(leadingEdgeMicros);
+	uint32_t gap = leadingEdge-PreviousLeadingEdge;
+	classifier.interval(gap > 0xFFFF ? 0xFFFF : gap);
+	bool marker = gap > classifier.syncGap();
+	PreviousLeadingEdge = leadingEdge;       
+
+	if (markerKnown && tracker.locked()) {
+		if (!placePulse(edgeTick, marker)) {
+			return;
+		}
+	} else if (marker) {
+		// The marker edge itself may be missing or a spike, count on from the last bit
+		finalizeBuffer(bitTick + 2);
+		markerTick   = edgeTick;
+		markerKnown  = true;
+		markerMisses = DCFMarkerMisses;
+	}
+	appendSignal(signal);
+	bitTick = edgeTick;
+}
+
+/**
+ * While the second ticks are locked, put the pulse at the bit position
+ * its tick gives. A missing pulse leaves a hole instead of shifting the
+ * rest of the frame, a pulse in the silent second is dropped, and the
+ * minute ends at its tick even when noise filled the marker gap. A gap
+ * inside the frame is a dropout once the marker position is confirmed,
+ * before that the frame is realigned to it.
+ * Returns false when the pulse is not to be appended
+ */
+inline bool DCF77::placePulse(uint32_t edgeTick, bool marker) {
+	uint32_t second = edgeTick - markerTick;
+	unsigned char length = frameLength();
+
+	if (second > length || (marker && second == 60)) {
+		// The minute is over; a gap at 60 is also a leap second that was not
+		bool onTime = marker && second <= (uint32_t)length + 1;
+		uint32_t frameEnd = onTime ? edgeTick : markerTick + length + 1;
+		addHoles(bufferPosition, 59);
+		if (bufferPosition < 59) bufferPosition = 59;
+		finalizeBuffer(frameEnd);
+		if (marker && !onTime && markerMisses >= DCFMarkerMisses) {
+			// A late gap only moves the marker while its position is not confirmed
+			markerTick = edgeTick;
+		} else {
+			// Minutes without any pulse are skipped whole
+			markerTick = frameEnd + (edgeTick - frameEnd) / 60 * 60;
+		}
+		if (onTime) {
+			markerMisses = 0;
+		} else if (markerMisses < DCFMarkerMisses) {
+			markerMisses++;
+		}
+		second = edgeTick - markerTick;
+	} else if (marker && markerMisses >= DCFMarkerMisses) {
+		// Not confirmed: this gap is the marker, the frame so far was misaligned
+		LogLn("EoM");
+		stats.minuteEnd();
+		stats.reject(QualityShort);
+		bufOk = false;
+		bufferinit();
+		markerTick = edgeTick;
+		return true;
+	} else if (second == length) {
+		LogLn("rSS");
+		stats.reject(QualityStray);
+		lastBit = 3;
+		bufOk = false;
+		return false;
+	} else if (second < (uint32_t)bufferPosition) {
+		// A second pulse in a second that already has its bit
+		LogLn("rDP");
+		stats.reject(QualityStray);
+		lastBit = 3;
+		bufOk = false;
+		return false;
+	}
+	addHoles(bufferPosition, second);
+	bufferPosition = second;
+	return true;
+}
+
+/**
+ * Record bits from..to-1 as not received. Only bits 15-58 count, the
+ * rest carries no time; one such bit can be repaired from its parity
+ */
+inline void DCF77::addHoles(unsigned char from, unsigned char to) {
+	if (from < 15) from = 15;
+	if (to > 59) to = 59;
+	if (from >= to) {
+		return;
+	}
+	frameHole = (to - from == 1 && frameHole == DCFNoHole) ? from : DCFHoles;
+}
+
+/**
+ * Bits of the running frame: 60 in the minute a leap second is inserted,
+ * which A2 (bit 19) announces and which is always the last of the hour,
+ * so the frame of minute 0
+ */
+inline unsigned char DCF77::frameLength(void) {
+	if (bufferPosition > 28 && (runningBuffer & (1ULL << 19)) && !(runningBuffer & (0xFFULL << 21))) {
+		return 60;
+	}
+	return 59;
+}
+
 /**
  * Add new bit to buffer
  */
 inline void DCF77::appendSignal(unsigned char signal) {
 	Log(signal, DEC);
+	stats.pulse();
 	lastBit = signal;
 	// BlinkDebug(!digitalRead(13));
 	runningBuffer = runningBuffer | ((unsigned long long) signal << bufferPosition);  
 	bufferPosition++;
-	if (bufferPosition > 59) {
+	if (bufferPosition > frameLength()) {
 		// Buffer is full before at end of time-sequence 
 		// this may be due to noise giving additional peaks
 		LogLn("EoB");
 		bufOk = false;
 		lastBit = 4;
-		finalizeBuffer();
+		finalizeBuffer(0);
 	}
 }
 
 /**
- * Finalize filled buffer
+ * Finalize filled buffer, tick is the second tick of the minute marker
+ * that ends it
  */
-inline void DCF77::finalizeBuffer(void) {
-  if (bufferPosition == 59) {
+inline void DCF77::finalizeBuffer(uint32_t tick) {
+  stats.minuteEnd();
+  if ((bufferPosition == 59 || bufferPosition == frameLength()) && frameHole != DCFHoles) {
 		// Buffer is full
 		LogLn("BF");
 		bufOk = true;
-		// Prepare filled buffer and time stamp for main loop
-		filledBuffer = runningBuffer;
-		filledTimestamp = now();
+		// Queue filled buffer and time stamp for main loop, unless it is full
+		unsigned char next = (frameHead + 1) & (DCFFrameQueueSize - 1);
+		if (next != frameTail) {
+			// The leap second bit 59 is always 0 and carries nothing
+			frameQueue[frameHead].bits = runningBuffer & ((1ULL << 59) - 1);
+			frameQueue[frameHead].receivedMillis = millis();
+			frameQueue[frameHead].tick = tick;
+			frameQueue[frameHead].hole = frameHole;
+			// Slot must be complete before the main loop can see it
+			compilerBarrier();
+			frameHead = next;
+			if (frameHandler) frameHandler();
+		} else {
+			LogLn("QF");
+			stats.reject(QualityQueueFull);
+			droppedFrames++;
+		}
 		// Reset running buffer
 		bufferinit();
-		FilledBufferAvailable = true;    
+    } else if (bufferPosition > frameLength()) {
+		// Overflow, "EoB" is logged already
+		stats.reject(QualityOverflow);
+		bufferinit();
+    } else if (frameHole == DCFHoles) {
+		// Complete, but too many pulses were missing to repair it
+		LogLn("BH");
+		stats.reject(QualityHoles);
+		bufOk = false;
+		bufferinit();
     } else {
 		// Buffer is not yet full at end of time-sequence
 		LogLn("EoM");
+		stats.reject(QualityShort);
 		bufOk = false;
 		// Reset running buffer
 		bufferinit();      
@@ -186,15 +469,68 @@ inline void DCF77::finalizeBuffer(void) {
 /**
  * Returns whether there is a new time update available
  * This functions should be called prior to getTime() function.
+ * All queued frames are evaluated in order; the newest accepted one wins.
  */
 bool DCF77::receivedTimeUpdate(void) {
-	// If buffer is not filled, there is no new time
-	if(!FilledBufferAvailable) {
+	// now() may call back into the sync provider while we are busy here
+	if (processingQueue) {
 		return false;
 	}
-	// if buffer is filled, we will process it and see if this results in valid parity
+	processingQueue = true;
+
+	bool updated = false;
+	time_t acceptedTime = 0;
+	time_t acceptedTimestamp = 0;
+	unsigned char acceptedCEST = 0;
+	unsigned char acceptedFlags = 0;
+	unsigned char heldFlags = flags;
+	uint32_t acceptedTick = 0;
+	while (frameTail != frameHead) {
+		if (acceptFrame()) {
+			stats.accepted();
+			updated           = true;
+			acceptedTime      = latestupdatedTime;
+			acceptedTimestamp = processingTimestamp;
+			acceptedCEST      = CEST;
+			acceptedFlags     = flags;
+			acceptedTick      = processingTick;
+		}
+	}
+	// A later frame that failed the checks must not replace an accepted one
+	if (updated) {
+		latestupdatedTime   = acceptedTime;
+		processingTimestamp = acceptedTimestamp;
+		CEST                = acceptedCEST;
+		latestTick          = acceptedTick;
+		time_t previousUTC  = phaseUTC;
+		phaseUTC            = latestupdatedTime - utcOffset()*SECS_PER_MIN;
+		phaseTick           = acceptedTick;
+		// The announcement bits have no parity: only believe them when the
+		// frame a minute or so before had them too
+		if (phaseUTC - previousUTC > 5*SECS_PER_MIN) previousFlags = 0;
+		flags               = acceptedFlags & (previousFlags | ~DCFFlagAnnouncements);
+		previousFlags       = acceptedFlags;
+	} else {
+		flags               = heldFlags;
+	}
+
+	processingQueue = false;
+	return updated;
+}
+
+/**
+ * Take the oldest queued frame and check whether it holds a plausible time
+ */
+bool DCF77::acceptFrame(void) {
+	// Process the frame and see if this results in valid parity
 	if (!processBuffer()) {
+#ifdef DCF_ACCUMULATOR
+		LogLn("Not locked");
+		stats.reject(QualityNotLocked);
+#else
 		LogLn("Invalid parity");
+		stats.reject(QualityParity);
+#endif
 		return false;
 	}
 	
@@ -203,9 +539,16 @@ bool DCF77::receivedTimeUpdate(void) {
 	time_t processedTime = latestupdatedTime + (now() - processingTimestamp);
 	if (processedTime<MIN_TIME || processedTime>MAX_TIME) {
 		LogLn("Time outside of bounds");
+		stats.reject(QualityBounds);
 		return false;
 	}
 
+#ifdef DCF_ACCUMULATOR
+	// Lock already means that several minutes agreed with each other
+	storePreviousTime();
+	return true;
+#endif
+
 	// If received time is close to internal clock (2 min) we are satisfied
 	time_t difference = abs(processedTime - now());
 	if(difference < 2*SECS_PER_MIN) {
@@ -219,12 +562,21 @@ bool DCF77::receivedTimeUpdate(void) {
 	time_t shiftPrevious = (previousUpdatedTime - previousProcessingTimestamp);
 	time_t shiftCurrent = (latestupdatedTime - processingTimestamp);	
 	time_t shiftDifference = abs(shiftCurrent-shiftPrevious);
+	// Before a reset a frame was accepted: if this first frame follows it
+	// closely enough, that frame stands in for the previous one
+	time_t frameUTC = latestupdatedTime - utcOffset()*SECS_PER_MIN;
+	bool followsRestored = previousUpdatedTime == 0 && restoredUTC != 0 &&
+		frameUTC > restoredUTC && frameUTC - restoredUTC <= DCFWarmStartAge;
 	storePreviousTime();
 	if(shiftDifference < 2*SECS_PER_MIN) {
 		LogLn("time lag consistent");		
 		return true;
+	} else if (followsRestored) {
+		LogLn("follows restored time");
+		return true;
 	} else {
 		LogLn("time lag inconsistent");
+		stats.reject(QualityLag);
 	}
 	
 	// If lag is inconsistent, this may be because of no previous stored date 
@@ -240,75 +592,57 @@ void DCF77::storePreviousTime(void) {
 	previousProcessingTimestamp = processingTimestamp;
 }
 
-/**
- * Calculate the parity of the time and date. 
- */
-void DCF77::calculateBufferParities(void) {	
-	// Calculate Parity 
-	flags.parityFlag = 0;	
-	for(int pos=0;pos<59;pos++) {
-		bool s = (processingBuffer >> pos) & 1;  
-		
-		// Update the parity bits. First: Reset when minute, hour or date starts.
-		if (pos ==  21 || pos ==  29 || pos ==  36) {
-			flags.parityFlag = 0;
-		}
-		// save the parity when the corresponding segment ends
-		if (pos ==  28) {flags.parityMin = flags.parityFlag;};
-		if (pos ==  35) {flags.parityHour = flags.parityFlag;};
-		if (pos ==  58) {flags.parityDate = flags.parityFlag;};
-		// When we received a 1, toggle the parity flag
-		if (s == 1) {
-			flags.parityFlag = flags.parityFlag ^ 1;
-		}
-	}
-}
-
 /**
  * Evaluates the information stored in the buffer. This is where the DCF77
  * signal is decoded 
  */
 bool DCF77::processBuffer(void) {	
+	PROFILE_SCOPE(PROFILE_DCF_PROCESS);
 	
 	/////  Start interaction with interrupt driven loop  /////
 	
-	// Copy filled buffer and timestamp from interrupt driven loop
-	processingBuffer = filledBuffer;
-	processingTimestamp = filledTimestamp;
-	// Indicate that there is no filled, unprocessed buffer anymore
-	FilledBufferAvailable = false;  
+	// Copy oldest queued buffer and timestamp from interrupt driven loop
+	unsigned char tail = frameTail;
+	processingBuffer = frameQueue[tail].bits;
+	uint32_t receivedMillis = frameQueue[tail].receivedMillis;
+	processingTick = frameQueue[tail].tick;
+	unsigned char hole = frameQueue[tail].hole;
+	// Release the slot only after it has been copied
+	compilerBarrier();
+	frameTail = (tail + 1) & (DCFFrameQueueSize - 1);
+	processingTimestamp = now() - (time_t)((millis() - receivedMillis) / 1000);
 	
 	/////  End interaction with interrupt driven loop   /////
 
-	//  Calculate parities for checking buffer
-	calculateBufferParities();
-	tmElements_t time;
-	bool proccessedSucces;
-
-	struct DCF77Buffer *rx_buffer;
-	rx_buffer = (struct DCF77Buffer *)(unsigned long long)&processingBuffer;
-
-	// Check parities
-    if (flags.parityMin == rx_buffer->P1  &&
-        flags.parityHour == rx_buffer->P2 &&
-        flags.parityDate == rx_buffer->P3 &&
-		rx_buffer->CEST != rx_buffer->CET) 
-    { 
-      //convert the received buffer into time	  	  	 
-      time.Second = 0;
-	  time.Minute = rx_buffer->Min-((rx_buffer->Min/16)*6);
-      time.Hour   = rx_buffer->Hour-((rx_buffer->Hour/16)*6);
-      time.Day    = rx_buffer->Day-((rx_buffer->Day/16)*6); 
-      time.Month  = rx_buffer->Month-((rx_buffer->Month/16)*6);
-      time.Year   = 2000 + rx_buffer->Year-((rx_buffer->Year/16)*6) -1970;
-	  latestupdatedTime = makeTime(time);	 
-	  CEST = rx_buffer->CEST;
-	  //Parity correct
-	  return true;
-	} else {
-	  //Parity incorrect
-	  return false;
+	if (hole != DCFNoHole) {
+		// One bit was not received, its parity tells what it was
+		FrameDecode::repair((uint8_t *)&processingBuffer, hole);
 	}
+
+#ifdef DCF_ACCUMULATOR
+	// Every complete frame adds evidence, whatever its parity
+	accumulator.add((const uint8_t *)&processingBuffer, receivedMillis);
+	if (!accumulator.locked()) {
+		return false;
+	}
+	latestupdatedTime = accumulator.time();
+	CEST = accumulator.CEST();
+	// Zone, call bit and announcements are voted over several frames too
+	flags = accumulator.flags();
+	return true;
+#else
+	// Check parities and convert the received buffer into time
+	FrameDecode::Fields fields;
+	if (!FrameDecode::decode((const uint8_t *)&processingBuffer, fields)) {
+		//Parity incorrect
+		return false;
+	}
+	latestupdatedTime = FrameDecode::toTime(fields);
+	CEST = fields.CEST;
+	flags = fields.flags;
+	//Parity correct
+	return true;
+#endif
 }
 
 /**
@@ -321,7 +655,7 @@ time_t DCF77::getTime(void)
 		return(0);
 	} else {
 		// Send out time, taking into account the difference between when the DCF time was received and the current time
-		time_t currentTime =latestupdatedTime + (now() - processingTimestamp);
+		time_t currentTime =latestupdatedTime + elapsedSinceFrame();
 		return(currentTime);
 	}
 }
@@ -336,47 +670,256 @@ time_t DCF77::getUTCTime(void)
 		return(0);
 	} else {
 		// Send out time UTC time
-		int UTCTimeDifference = (CEST ? 2 : 1)*SECS_PER_HOUR;
-		time_t currentTime =latestupdatedTime - UTCTimeDifference + (now() - processingTimestamp);
+		time_t UTCTimeDifference = utcOffset()*SECS_PER_MIN;
+		time_t currentTime =latestupdatedTime - UTCTimeDifference + elapsedSinceFrame();
 		return(currentTime);
 	}
 }
 
+/**
+ * Seconds since the minute marker of the most recent frame. Counted in
+ * tracked second ticks when locked, otherwise from the internal clock
+ */
+time_t DCF77::elapsedSinceFrame(void)
+{
+	uint32_t tick, sinceTick;
+	if (tracker.now(tick, sinceTick)) {
+		return (time_t)(tick - latestTick);
+	}
+	return now() - processingTimestamp;
+}
+
+/**
+ * UTC second in progress and the micros() elapsed since its edge, from the
+ * most recently accepted frame and the tracked second ticks. Unlike
+ * getUTCTime() this can be called any time; false until locked.
+ */
+bool DCF77::getUTCPhase(time_t &utc, uint32_t &sinceSecond)
+{
+	uint32_t tick;
+	if (phaseUTC == 0 || !tracker.now(tick, sinceSecond)) {
+		return false;
+	}
+	utc = phaseUTC + (time_t)(tick - phaseTick);
+	return true;
+}
+
+/**
+ * Call bit, zone and announcements (DCFFlag*) of the most recently
+ * accepted frame. An announcement only counts once two frames in a row
+ * carried it.
+ */
+unsigned char DCF77::getFlags(void)
+{
+	return flags;
+}
+
+/**
+ * Announcements the most recently accepted frame carried that getFlags()
+ * does not report yet, as the frame before did not carry them
+ */
+unsigned char DCF77::pendingAnnouncements(void)
+{
+	return previousFlags & DCFFlagAnnouncements & ~flags;
+}
+
+/**
+ * UTC offset of the transmitted time in minutes: 120 for CEST, 60 for CET
+ */
+int DCF77::utcOffset(void)
+{
+	return CEST ? 120 : 60;
+}
+
+/**
+ * UTC of the end of the hour an announced zone change or leap second
+ * takes effect, 0 without announcement. The frame of the first minute
+ * after a zone change still carries A1 but already the new zone; then
+ * this is 0 too.
+ */
+time_t DCF77::announcedAt(void)
+{
+	if (!(flags & DCFFlagAnnouncements) || phaseUTC % SECS_PER_HOUR == 0) {
+		return 0;
+	}
+	return phaseUTC - phaseUTC % SECS_PER_HOUR + SECS_PER_HOUR;
+}
+
+/**
+ * What the decoder learned so far, to be given to restore() after a reset
+ */
+void DCF77::state(DCF77State &state)
+{
+	PulseClassifier::Parameters pulses;
+	classifier.parameters(pulses);
+	state.utc        = phaseUTC ? phaseUTC : restoredUTC;
+	state.shortWidth = pulses.learned ? pulses.shortWidth : 0;
+	state.longWidth  = pulses.learned ? pulses.longWidth : 0;
+	state.inverted   = pulses.inverted;
+	stats.averages(state.frameScore, state.pulseScore);
+	state.interrupt  = dCFinterrupt;
+}
+
+/**
+ * Continue from the state() of an earlier run: the learned pulses and the
+ * polarity apply right away, and the first frame is accepted without a
+ * second one when it follows the saved frame within DCFWarmStartAge.
+ * The pulses are only taken from a receiver on the same interrupt; the
+ * frame and the quality averages from any
+ */
+void DCF77::restore(const DCF77State &state)
+{
+	stats.restore(state.frameScore, state.pulseScore);
+	restoredUTC = state.utc;
+	if (state.interrupt != dCFinterrupt) return;
+
+	PulseClassifier::Parameters pulses;
+	uint8_t sreg = intDisable();
+	classifier.parameters(pulses);
+#ifndef DCF_SAMPLED
+	if (pulses.inverted != (bool)state.inverted) {
+		// As if the classifier had found the inversion itself
+		pulseStart = (pulseStart == HIGH) ? LOW : HIGH;
+		bufferinit();
+		markerKnown = false;
+	}
+#endif
+	if (classifier.seed(state.shortWidth, state.longWidth, state.inverted)) {
+		LogLn("restored pulses");
+	}
+	intRestore(sreg);
+}
+
+/**
+ * Reception quality 0..100 from recent frames and pulses, see SignalQuality
+ */
+unsigned char DCF77::quality(void)
+{
+	return stats.score();
+}
+
+/**
+ * The reception statistics of this receiver, e.g. for SignalQuality::report()
+ */
+SignalQuality &DCF77::statistics(void)
+{
+	return stats;
+}
+
+/**
+ * Whether the second ticks are phase locked
+ */
+bool DCF77::secondLocked(void)
+{
+	return tracker.locked();
+}
+
+/**
+ * Smoothed deviation of the received second edges from the tracked phase, us
+ */
+unsigned int DCF77::secondJitter(void)
+{
+	return tracker.jitter();
+}
+
+/**
+ * Learned length of a second in micros() units
+ */
+uint32_t DCF77::secondPeriod(void)
+{
+	return tracker.period();
+}
+
 int DCF77::bufLen(void)
 {
 	return bufferPosition;
 }
 
 /**
- * Initialize parameters
+ * Pulse widths, split and gap thresholds as currently learned
  */
-int DCF77::dCF77Pin=0;
-int DCF77::dCFinterrupt=0;
-byte DCF77::pulseStart=HIGH;
+void DCF77::pulseParameters(PulseClassifier::Parameters &parameters)
+{
+	classifier.parameters(parameters);
+}
 
-// Parameters shared between interupt loop and main loop
+#ifdef DCF_SAMPLED
+/**
+ * Correlation of the sampled signal at the detected second boundary,
+ * 0..2480; below SampleMinScore no boundary is trusted
+ */
+int DCF77::sampleScore(void)
+{
+	return sampler.score();
+}
+#endif
 
-volatile unsigned long long DCF77::filledBuffer = 0;
-volatile bool DCF77::FilledBufferAvailable= false;
-volatile time_t DCF77::filledTimestamp= 0;
+#ifdef DCF_ACCUMULATOR
+/**
+ * How far the accumulated frames are from lock, 0..100 (100 = locked)
+ */
+unsigned char DCF77::lockConfidence(void)
+{
+	return accumulator.confidence();
+}
+#endif
 
-// DCF Buffers and indicators
-int DCF77::bufferPosition = 0;
-unsigned long long DCF77::runningBuffer = 0;
-unsigned long long DCF77::processingBuffer = 0;
+/**
+ * Number of received frames waiting for the main loop
+ */
+unsigned char DCF77::framesPending(void)
+{
+	return (frameHead - frameTail) & (DCFFrameQueueSize - 1);
+}
+
+/**
+ * Call handler from the interrupt each time a frame is queued, e.g. to wake
+ * the main loop. It must be short; NULL removes it
+ */
+void DCF77::onFrame(void (*handler)(void))
+{
+	uint8_t sreg = intDisable();
+	frameHandler = handler;
+	intRestore(sreg);
+}
+
+/**
+ * Number of frames lost because the main loop did not collect them in time
+ */
+unsigned int DCF77::framesDropped(void)
+{
+	uint8_t sreg = intDisable();
+	unsigned int dropped = droppedFrames;
+	intRestore(sreg);
+	return dropped;
+}
 
-// Pulse flanks
-int DCF77::leadingEdge=0;
-int DCF77::trailingEdge=0;
-int DCF77::PreviousLeadingEdge=0;
-bool DCF77::Up= false;
+#ifdef DCF_CAPTURE
+/**
+ * Send captured edges over Serial. Call regularly from the main loop
+ */
+void DCF77::flushCapture(void)
+{
+	Capture::flush();
+}
 
-// DCF77 and internal timestamps
-time_t DCF77::latestupdatedTime= 0;
-time_t DCF77::previousUpdatedTime= 0;
-time_t DCF77::processingTimestamp= 0;
-time_t DCF77::previousProcessingTimestamp=0;
-unsigned char DCF77::CEST=0;
-DCF77::ParityFlags DCF77::flags = {0,0,0,0};
+uint16_t DCF77::captureDropped(void)
+{
+	return Capture::dropped();
+}
+#endif
 
+#ifdef DCF_VERBOSE_DEBUG
+/**
+ * Print the queued debug log over Serial. Call regularly from the main loop
+ */
+void DCF77::flushLog(void)
+{
+	Utils::LogFlush();
+}
 
+uint16_t DCF77::logDropped(void)
+{
+	return Utils::LogDropped();
+}
+#endif
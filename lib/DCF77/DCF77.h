@@ -7,37 +7,101 @@
 #include <WProgram.h> 
 #endif
 #include <Time.h>
+#include <PulseClassifier.h>
+#include <SignalQuality.h>
+#include <SecondTracker.h>
+#include <Sampler.h>
+#include <Accumulator.h>
 
 #define MIN_TIME 1334102400     // Date: 11-4-2012
 #define MAX_TIME 4102444800     // Date:  1-1-2100
 
+// Pulse timing until PulseClassifier has learned the receiver at hand
 #define DCFRejectionTime 700    // Pulse-to-Pulse rejection time. 
 #define DCFRejectPulseWidth 50  // Minimal pulse width
 #define DCFSplitTime 180        // Specifications distinguishes pulse width 100 ms and 200 ms. In practice we see 130 ms and 230
 #define DCFSyncTime 1500        // Specifications defines 2000 ms pulse for end of sequence
+#define DCFFrameQueueSize 4     // Frames buffered between interrupt and main loop, power of two
+#define DCFMarkerMisses 2       // Minutes without the gap at the tracked minute marker before realigning
+#define DCFNoHole 0             // DCF77Frame::hole: all bits received
+#define DCFHoles 0xFF           // DCF77Frame::hole: more than one bit missing
+#define DCFMaxReceivers 2       // Receivers started at once, by interrupt number (INT0, INT1)
 
+// Frame bits 15-19 as returned by getFlags()
+#define DCFFlagCall         0x01  // R: call bit, transmitter irregularity
+#define DCFFlagZoneChange   0x02  // A1: CET/CEST change at the end of this hour
+#define DCFFlagCEST         0x04  // Z1: the time is CEST
+#define DCFFlagCET          0x08  // Z2: the time is CET
+#define DCFFlagLeapSecond   0x10  // A2: leap second at the end of this hour
+#define DCFFlagAnnouncements (DCFFlagZoneChange | DCFFlagLeapSecond)
+
+#define DCFWarmStartAge 604800  // s, a first frame this soon after the restored one needs no second
+
+// What the decoder learned, to be kept across a reset: see DCF77::state()
+struct DCF77State {
+    uint32_t utc;              // UTC minute of the last accepted frame, 0 none
+    uint16_t shortWidth;       // ms, learned pulse clusters, 0 not learned
+    uint16_t longWidth;
+    uint8_t  inverted;         // receiver output is inverted
+    uint8_t  frameScore;       // SignalQuality moving averages, percent
+    uint8_t  pulseScore;
+    uint8_t  interrupt;        // of the receiver the pulses were learned on
+};
+
+/*
+  Each DCF77 object is a receiver of its own: all decoding state, pulse
+  classification, second tracking and statistics live in the object, so
+  up to DCFMaxReceivers can run side by side (see DCF77Combiner). Start()
+  registers the object for its interrupt number and routes that
+  interrupt to it; with DCF_SAMPLED the one sample timer serves all
+  started receivers and the interrupt number only picks the slot.
+  Edge capture (DCF_CAPTURE) records the receiver on interrupt 0.
+*/
 class DCF77 {
 private:
 
+    // Started receivers by interrupt number, for the interrupt trampolines
+    static DCF77 *receivers[DCFMaxReceivers];
+    static void int0trampoline(void);
+    static void int1trampoline(void);
+#ifdef DCF_SAMPLED
+    static void sampleTrampoline(void);
+#endif
+
     //Private variables
     bool initialized;   
-    static int dCF77Pin;
-    static int dCFinterrupt;
-    static byte pulseStart;
+    int dCF77Pin;
+    int dCFinterrupt;
+    byte pulseStart;
+
+    PulseClassifier classifier;
+    SecondTracker   tracker;
+    SignalQuality   stats;
+#ifdef DCF_SAMPLED
+    Sampler         sampler;
+#endif
+#ifdef DCF_ACCUMULATOR
+    Accumulator     accumulator;
+#endif
 
     // DCF77 and internal timestamps
-    static time_t previousUpdatedTime;
-    static time_t latestupdatedTime;            
-    static  time_t processingTimestamp;
-    static  time_t previousProcessingTimestamp;     
-    static unsigned char CEST;
-    // DCF time format structure
+    time_t previousUpdatedTime;
+    time_t latestupdatedTime;            
+    time_t processingTimestamp;
+    time_t previousProcessingTimestamp;     
+    unsigned char CEST;
+    unsigned char flags;             // of the accepted frame
+    unsigned char previousFlags;     // of the frame before, for the announcements
+    // DCF time format structure (decoded byte-wise by FrameDecode)
     struct DCF77Buffer {
       //unsigned long long prefix       :21;
-      unsigned long long prefix     :17;
+      unsigned long long prefix     :15;
+      unsigned long long Call       :1; // call bit
+      unsigned long long ZoneChange :1; // A1, CET/CEST change announced
       unsigned long long CEST       :1; // CEST 
       unsigned long long CET        :1; // CET 
-      unsigned long long unused     :2; // unused bits
+      unsigned long long LeapSecond :1; // A2, leap second announced
+      unsigned long long Start      :1; // start of time, always 1
       unsigned long long Min        :7; // minutes
       unsigned long long P1         :1; // parity minutes
       unsigned long long Hour       :6; // hours
@@ -49,53 +113,114 @@ private:
       unsigned long long P3         :1; // parity
     };
     
-    
-    // DCF Parity format structure
-    struct ParityFlags{
-        unsigned char parityFlag    :1;
-        unsigned char parityMin     :1;
-        unsigned char parityHour    :1;
-        unsigned char parityDate    :1;
-    } static flags;
-
-    // Parameters shared between interupt loop and main loop
-    static volatile bool FilledBufferAvailable;
-    static volatile unsigned long long filledBuffer;
-    static volatile time_t filledTimestamp;
+
+    // Received frame with the millis() of its end of minute, the
+    // SecondTracker tick of its minute marker and the one bit (15-58)
+    // that may be missing, to be repaired from its parity
+    struct DCF77Frame {
+        unsigned long long bits;
+        uint32_t           receivedMillis;
+        uint32_t           tick;
+        unsigned char      hole;
+    };
+
+    // Parameters shared between interupt loop and main loop:
+    // single producer (ISR) / single consumer (main loop) ring. Each index
+    // is only written by one side and is a single byte, so no locking is needed.
+    DCF77Frame frameQueue[DCFFrameQueueSize];
+    volatile unsigned char frameHead;
+    volatile unsigned char frameTail;
+    volatile unsigned int  droppedFrames;
+    bool processingQueue;
+    void (*frameHandler)(void);
 
     // DCF Buffers and indicators
-    static int  bufferPosition;
-    static unsigned long long runningBuffer;
-    static unsigned long long processingBuffer;
+    int  bufferPosition;
+    unsigned long long runningBuffer;
+    unsigned long long processingBuffer;
+    uint32_t processingTick;
+    uint32_t latestTick;
+
+    // Alignment of the running frame to the second ticks: while the
+    // tracker is locked the tick of a pulse tells its bit position
+    bool markerKnown;
+    uint32_t markerTick;          // tick of second 0 of the running frame
+    unsigned char markerMisses;   // minutes without the gap where the marker was expected
+    unsigned char frameHole;      // missing bit of the running frame, DCFNoHole/DCFHoles
+
+    // Most recently accepted UTC minute and its tick, for getUTCPhase()
+    time_t phaseUTC;
+    uint32_t phaseTick;
+    // UTC minute of the frame accepted before a reset, see restore()
+    time_t restoredUTC;
 
     // Pulse flanks
-    static   int  leadingEdge;
-    static   int  trailingEdge;
-    static   int  PreviousLeadingEdge;
-    static   bool Up;
+    uint32_t leadingEdge;
+    uint32_t leadingEdgeMicros;
+    uint32_t trailingEdge;
+    uint32_t PreviousLeadingEdge;
+    uint32_t bitTick;           // SecondTracker tick of the last appended bit
+    bool Up;
     
     //Private functions
-    void static initialize(void);
-    void static bufferinit(void);
-    void static finalizeBuffer(void);
-    static bool receivedTimeUpdate(void);
-    void static storePreviousTime(void);
-    void static calculateBufferParities(void);
-    bool static processBuffer(void);
-    void static appendSignal(unsigned char signal);
+    void initialize(void);
+    void bufferinit(void);
+    void finalizeBuffer(uint32_t tick);
+    unsigned char frameLength(void);
+    bool placePulse(uint32_t edgeTick, bool marker);
+    void addHoles(unsigned char from, unsigned char to);
+    bool receivedTimeUpdate(void);
+    bool acceptFrame(void);
+    void storePreviousTime(void);
+    bool processBuffer(void);
+    void appendSignal(unsigned char signal);
+    void acceptPulse(unsigned char signal);
+    time_t elapsedSinceFrame(void);
 
 public: 
     // Public Functions
     DCF77(int DCF77Pin, int DCFinterrupt, bool OnRisingFlank=true); 
+    ~DCF77();
     
-    static time_t getTime(void);
-    static time_t getUTCTime(void);
-    static void Start(void);
-    static void Stop(void);
-    static void int0handler();
-    static int  bufLen(void);
-    static char lastBit;
-    static bool bufOk;
+    time_t getTime(void);
+    time_t getUTCTime(void);
+    void Start(void);
+    void Stop(void);
+    void int0handler();
+#ifdef DCF_SAMPLED
+    void sampleHandler();
+    int  sampleScore(void);
+#endif
+    int  bufLen(void);
+    unsigned char framesPending(void);
+    void onFrame(void (*handler)(void));
+    unsigned int  framesDropped(void);
+    bool getUTCPhase(time_t &utc, uint32_t &sinceSecond);
+    unsigned char getFlags(void);
+    unsigned char pendingAnnouncements(void);
+    int utcOffset(void);
+    time_t announcedAt(void);
+    unsigned char quality(void);
+    SignalQuality &statistics(void);
+    bool secondLocked(void);
+    unsigned int secondJitter(void);
+    uint32_t secondPeriod(void);
+    void pulseParameters(PulseClassifier::Parameters &parameters);
+    void state(DCF77State &state);
+    void restore(const DCF77State &state);
+#ifdef DCF_ACCUMULATOR
+    unsigned char lockConfidence(void);
+#endif
+#ifdef DCF_CAPTURE
+    void flushCapture(void);
+    uint16_t captureDropped(void);
+#endif
+#ifdef DCF_VERBOSE_DEBUG
+    void flushLog(void);
+    uint16_t logDropped(void);
+#endif
+    char lastBit;
+    bool bufOk;
  };
 
 #endif
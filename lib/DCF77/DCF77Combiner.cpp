@@ -0,0 +1,244 @@
+/*
+  DCF77Combiner.cpp - two DCF77 receivers used as one, see DCF77Combiner.h
+*/
+
+#include <DCF77Combiner.h>
+
+/**
+ * Constructor; both receivers must be on different interrupts
+ */
+DCF77Combiner::DCF77Combiner(DCF77 &first, DCF77 &second)
+	: current(0), deliveredUTC(0)
+{
+	receivers[0] = &first;
+	receivers[1] = &second;
+	frameUTC[0] = frameUTC[1] = 0;
+}
+
+/**
+ * Index of the receiver with the better quality(); on a tie the one
+ * whose frame was delivered last
+ */
+unsigned char DCF77Combiner::better(void)
+{
+	unsigned char other = 1 - current;
+	return receivers[other]->quality() > receivers[current]->quality() ? other : current;
+}
+
+/**
+ * The receiver with the better quality(), e.g. to show its progress
+ */
+DCF77 &DCF77Combiner::best(void)
+{
+	return *receivers[better()];
+}
+
+/**
+ * Whether utc is within a minute of a frame received at millis() at,
+ * carried on by the time since then; false without frame
+ */
+static bool near(time_t utc, time_t frame, uint32_t at)
+{
+	if (frame == 0) return false;
+	time_t expected = frame + (time_t)((millis() - at) / 1000);
+	return utc > expected - SECS_PER_MIN && utc < expected + SECS_PER_MIN;
+}
+
+/**
+ * Whether the new minute of receiver i may be delivered. One that agrees
+ * with the minute delivered last, or with now() once the time is set,
+ * always may. Otherwise a minute of the weaker receiver waits for the
+ * better one to agree, and one of the better receiver for the other
+ * receiver or its own previous frame; only with nothing delivered yet
+ * the better receiver counts alone.
+ */
+bool DCF77Combiner::trusted(unsigned char i, unsigned char first, const time_t *times)
+{
+	time_t utc = times[i];
+	unsigned char other = 1 - i;
+	if (near(utc, deliveredUTC, deliveredMillis)) return true;
+	if (timeStatus() != timeNotSet && near(utc, now(), millis())) return true;
+	if (i != first) return near(utc, times[first], millis()) || near(utc, frameUTC[first], frameMillis[first]);
+	if (deliveredUTC == 0) return true;
+	return near(utc, times[other], millis()) || near(utc, frameUTC[other], frameMillis[other]) ||
+	       near(utc, frameUTC[i], frameMillis[i]);
+}
+
+/**
+ * Get UTC time of a newly received minute from either receiver, 0 when
+ * neither has one. A minute already delivered is not repeated, and one
+ * that is not trusted() is left out
+ */
+time_t DCF77Combiner::getUTCTime(void)
+{
+	// Ask both, so neither keeps a frame of a minute that is over
+	time_t times[2];
+	times[0] = receivers[0]->getUTCTime();
+	times[1] = receivers[1]->getUTCTime();
+
+	unsigned char first = better();
+	time_t delivered = 0;
+	for (unsigned char n = 0; n < 2 && delivered == 0; n++) {
+		unsigned char i = (n == 0) ? first : 1 - first;
+		if (times[i] == 0) continue;
+		time_t minute = times[i] - times[i] % SECS_PER_MIN;
+		if (minute == deliveredUTC - deliveredUTC % SECS_PER_MIN) continue;
+		if (!trusted(i, first, times)) continue;
+		current = i;
+		delivered = deliveredUTC = times[i];
+		deliveredMillis = millis();
+	}
+	// Only now, so that trusted() compares with the frames before
+	for (unsigned char i = 0; i < 2; i++) {
+		if (times[i] == 0) continue;
+		frameUTC[i] = times[i];
+		frameMillis[i] = millis();
+	}
+	return delivered;
+}
+
+void DCF77Combiner::Start(void)
+{
+	receivers[0]->Start();
+	receivers[1]->Start();
+}
+
+void DCF77Combiner::Stop(void)
+{
+	receivers[0]->Stop();
+	receivers[1]->Stop();
+}
+
+int DCF77Combiner::bufLen(void)
+{
+	return best().bufLen();
+}
+
+unsigned char DCF77Combiner::framesPending(void)
+{
+	return receivers[0]->framesPending() + receivers[1]->framesPending();
+}
+
+/**
+ * The handler is called for the frames of both receivers
+ */
+void DCF77Combiner::onFrame(void (*handler)(void))
+{
+	receivers[0]->onFrame(handler);
+	receivers[1]->onFrame(handler);
+}
+
+unsigned int DCF77Combiner::framesDropped(void)
+{
+	return receivers[0]->framesDropped() + receivers[1]->framesDropped();
+}
+
+/**
+ * Second phase of the receiver of the last frame, else of the other one
+ * when that is locked to the second marks
+ */
+bool DCF77Combiner::getUTCPhase(time_t &utc, uint32_t &sinceSecond)
+{
+	return receivers[current]->getUTCPhase(utc, sinceSecond) ||
+	       receivers[1 - current]->getUTCPhase(utc, sinceSecond);
+}
+
+unsigned char DCF77Combiner::getFlags(void)
+{
+	return receivers[current]->getFlags();
+}
+
+unsigned char DCF77Combiner::pendingAnnouncements(void)
+{
+	return receivers[current]->pendingAnnouncements();
+}
+
+int DCF77Combiner::utcOffset(void)
+{
+	return receivers[current]->utcOffset();
+}
+
+time_t DCF77Combiner::announcedAt(void)
+{
+	return receivers[current]->announcedAt();
+}
+
+/**
+ * Quality of the better receiver: what the clock can count on
+ */
+unsigned char DCF77Combiner::quality(void)
+{
+	return best().quality();
+}
+
+SignalQuality &DCF77Combiner::statistics(void)
+{
+	return best().statistics();
+}
+
+bool DCF77Combiner::secondLocked(void)
+{
+	return receivers[0]->secondLocked() || receivers[1]->secondLocked();
+}
+
+unsigned int DCF77Combiner::secondJitter(void)
+{
+	return receivers[current]->secondJitter();
+}
+
+uint32_t DCF77Combiner::secondPeriod(void)
+{
+	return receivers[current]->secondPeriod();
+}
+
+void DCF77Combiner::pulseParameters(PulseClassifier::Parameters &parameters)
+{
+	receivers[current]->pulseParameters(parameters);
+}
+
+/**
+ * State of the receiver of the last frame, which has the latest minute
+ */
+void DCF77Combiner::state(DCF77State &state)
+{
+	receivers[current]->state(state);
+}
+
+/**
+ * Both receivers continue from the saved frame and quality; the pulses
+ * and polarity only go to the receiver they were learned on, the other
+ * one learns its own as after a cold start
+ */
+void DCF77Combiner::restore(const DCF77State &state)
+{
+	receivers[0]->restore(state);
+	receivers[1]->restore(state);
+	deliveredUTC = 0;
+	frameUTC[0] = frameUTC[1] = 0;
+}
+
+#ifdef DCF_CAPTURE
+// Capture records interrupt 0 only, shared by all DCF77 objects
+void DCF77Combiner::flushCapture(void)
+{
+	receivers[0]->flushCapture();
+}
+
+uint16_t DCF77Combiner::captureDropped(void)
+{
+	return receivers[0]->captureDropped();
+}
+#endif
+
+#ifdef DCF_VERBOSE_DEBUG
+// One log for all receivers
+void DCF77Combiner::flushLog(void)
+{
+	receivers[0]->flushLog();
+}
+
+uint16_t DCF77Combiner::logDropped(void)
+{
+	return receivers[0]->logDropped();
+}
+#endif
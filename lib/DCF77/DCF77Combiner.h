@@ -0,0 +1,68 @@
+#ifndef DCF77Combiner_h
+#define DCF77Combiner_h
+
+#include <DCF77.h>
+
+/*
+  Two DCF77 receivers, e.g. antennas at right angles or in different
+  places, used as one. Each decodes on its own; getUTCTime() delivers a
+  new minute from either, the one with the better quality() first. A
+  minute that does not agree with the one delivered last (or now())
+  needs a second opinion: one from the weaker receiver waits until the
+  better receiver agrees, one from the better receiver until the other
+  receiver or its own next frame does. So the weaker antenna fills in
+  the minutes the better one misses, a frame that one of them
+  misdecodes does not get through on its own word, and at a cold start
+  the clock locks as soon as the better receiver has two good frames.
+
+  The calls mirror those of DCF77: the frame details (flags, offset,
+  second phase) come from the receiver whose frame was delivered last,
+  the progress of the running frame from the better receiver.
+*/
+class DCF77Combiner {
+private:
+    DCF77 *receivers[2];
+    unsigned char current;     // receiver of the last delivered frame
+    time_t deliveredUTC;       // UTC of the last delivered frame, 0 none
+    uint32_t deliveredMillis;  // millis() when it was delivered
+    time_t frameUTC[2];        // UTC of each receiver's last frame, 0 none
+    uint32_t frameMillis[2];   // millis() when it was collected
+
+    unsigned char better(void);
+    bool trusted(unsigned char i, unsigned char first, const time_t *times);
+
+public:
+    DCF77Combiner(DCF77 &first, DCF77 &second);
+
+    time_t getUTCTime(void);
+    void Start(void);
+    void Stop(void);
+    DCF77 &best(void);
+    int  bufLen(void);
+    unsigned char framesPending(void);
+    void onFrame(void (*handler)(void));
+    unsigned int  framesDropped(void);
+    bool getUTCPhase(time_t &utc, uint32_t &sinceSecond);
+    unsigned char getFlags(void);
+    unsigned char pendingAnnouncements(void);
+    int utcOffset(void);
+    time_t announcedAt(void);
+    unsigned char quality(void);
+    SignalQuality &statistics(void);
+    bool secondLocked(void);
+    unsigned int secondJitter(void);
+    uint32_t secondPeriod(void);
+    void pulseParameters(PulseClassifier::Parameters &parameters);
+    void state(DCF77State &state);
+    void restore(const DCF77State &state);
+#ifdef DCF_CAPTURE
+    void flushCapture(void);
+    uint16_t captureDropped(void);
+#endif
+#ifdef DCF_VERBOSE_DEBUG
+    void flushLog(void);
+    uint16_t logDropped(void);
+#endif
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include "Accumulator.h"
+
+#ifdef DCF_ACCUMULATOR
+
+static const int8_t  zoneVoteLimit = 4;
+static const int8_t  flagVoteLimit = 4;
+static const uint8_t binLimit = 255 - 8;
+
+static const uint8_t monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+// Number of set bits of every nibble
+static const uint8_t nibbleBits[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+
+static inline uint8_t popcount8(uint8_t x)
+{
+	return nibbleBits[x & 0x0F] + nibbleBits[x >> 4];
+}
+
+// BCD code of value, with even parity bit at parityPos (0: none)
+static uint8_t encode(uint8_t value, uint8_t parityPos)
+{
+	uint8_t code = ((value / 10) << 4) | (value % 10);
+	if (parityPos) code |= (popcount8(code) & 1) << parityPos;
+	return code;
+}
+
+/**
+ * Add the match count of one received field to every candidate
+ */
+static void score(uint8_t *bins, uint8_t size, uint8_t first, uint8_t offset,
+                  uint8_t received, uint8_t width, uint8_t parityPos)
+{
+	bool halve = false;
+	uint8_t value = offset;
+	for (uint8_t h = 0; h < size; h++) {
+		bins[h] += width - popcount8(encode(value + first, parityPos) ^ received);
+		if (bins[h] > binLimit) halve = true;
+		if (++value == size) value = 0;
+	}
+	// Keep headroom; halving keeps the ranking and fades old evidence
+	if (halve) {
+		for (uint8_t h = 0; h < size; h++) bins[h] >>= 1;
+	}
+}
+
+/**
+ * Best candidate value of a field and its lead over the runner-up
+ */
+static uint8_t best(const uint8_t *bins, uint8_t size, uint8_t first, uint8_t offset,
+                    uint8_t *margin = 0)
+{
+	uint8_t top = 0, second = 0, topIndex = 0;
+	for (uint8_t h = 0; h < size; h++) {
+		if (bins[h] > top) {
+			second = top;
+			top = bins[h];
+			topIndex = h;
+		} else if (bins[h] > second) {
+			second = bins[h];
+		}
+	}
+	if (margin) *margin = top - second;
+	uint8_t value = topIndex + offset;
+	if (value >= size) value -= size;
+	return value + first;
+}
+
+// Days of a month, year of the century
+static uint8_t monthLength(uint8_t month, uint8_t year)
+{
+	return monthDays[month - 1] + (month == 2 && (year & 3) == 0);
+}
+
+// One frame's say on a bit without parity
+static void vote(int8_t &votes, bool set, int8_t limit)
+{
+	if (set  && votes <  limit) votes++;
+	if (!set && votes > -limit) votes--;
+}
+
+static uint8_t confidenceOf(uint8_t margin, uint8_t threshold)
+{
+	return margin >= threshold ? 100 : (uint16_t)margin * 100 / threshold;
+}
+
+void Accumulator::fields(FrameDecode::Fields &f)
+{
+	f.time.Second = 0;
+	f.time.Minute = best(minuteBins, 60, 0, minuteOffset);
+	f.time.Hour   = best(hourBins, 24, 0, hourOffset);
+	f.time.Day    = best(dayBins, 31, 1, dayOffset);
+	f.time.Wday   = best(weekdayBins, 7, 1, weekdayOffset);
+	f.time.Month  = best(monthBins, 12, 1, monthOffset);
+	f.time.Year   = best(yearBins, 100, 0, yearOffset) + 30;
+	f.CEST = zoneVotes > 0;
+	f.CET  = zoneVotes < 0;
+}
+
+/**
+ * Advance the rotating fields by a number of minutes, carrying into
+ * hours and days from the currently best minute and hour, and from the
+ * best date into month and year at the end of the month
+ */
+void Accumulator::advance(uint16_t minutes)
+{
+	uint16_t hours = (best(minuteBins, 60, 0, minuteOffset) + minutes) / 60;
+	minuteOffset = (minuteOffset + minutes) % 60;
+	if (hours == 0) return;
+	uint16_t days = (best(hourBins, 24, 0, hourOffset) + hours) / 24;
+	hourOffset = (hourOffset + hours) % 24;
+	clearAnnouncements();
+	if (days == 0) return;
+	weekdayOffset = (weekdayOffset + days) % 7;
+	uint8_t day   = best(dayBins, 31, 1, dayOffset);
+	uint8_t month = best(monthBins, 12, 1, monthOffset);
+	uint8_t year  = best(yearBins, 100, 0, yearOffset);
+	uint8_t shift = 0;
+	for (; days > 0; days--) {
+		if (day < monthLength(month, year)) {
+			day++;
+			shift++;
+			continue;
+		}
+		// Rotate the best day on to 1, the month and year candidates on by one
+		shift += 32 - day;
+		day = 1;
+		monthOffset = (monthOffset + 1) % 12;
+		if (++month <= 12) continue;
+		month = 1;
+		yearOffset = (yearOffset + 1) % 100;
+		year = (year + 1) % 100;
+	}
+	dayOffset = (dayOffset + shift) % 31;
+}
+
+/**
+ * Follow a summer time switch that the prediction just stepped over:
+ * last Sunday of March 02:00 CET -> 03:00 CEST, last Sunday of October
+ * 03:00 CEST -> 02:00 CET
+ */
+void Accumulator::followZoneChange(uint16_t minutes)
+{
+	if (zoneVotes == 0) return;
+	FrameDecode::Fields f;
+	fields(f);
+	time_t now = FrameDecode::toTime(f);
+	uint16_t year = f.time.Year + 1970;
+	FrameDecode::Fields change = f;
+	change.time.Minute = 0;
+	if (zoneVotes < 0) {
+		change.time.Month = 3;
+		change.time.Day   = 31 - (5 * year / 4 + 4) % 7;
+		change.time.Hour  = 2;
+	} else {
+		change.time.Month = 10;
+		change.time.Day   = 31 - (5 * year / 4 + 1) % 7;
+		change.time.Hour  = 3;
+	}
+	time_t at = FrameDecode::toTime(change);
+	if (now < at || now - (time_t)minutes * SECS_PER_MIN >= at) return;
+	if (zoneVotes < 0) {
+		hourOffset = (hourOffset + 1) % 24;
+		zoneVotes = zoneVoteLimit;
+	} else {
+		hourOffset = (hourOffset + 23) % 24;
+		zoneVotes = -zoneVoteLimit;
+	}
+}
+
+/**
+ * A new hour: what the previous one announced has taken effect
+ */
+void Accumulator::clearAnnouncements(void)
+{
+	zoneChangeVotes = leapVotes = -flagVoteLimit;
+}
+
+Accumulator::Accumulator()
+{
+	reset();
+}
+
+void Accumulator::reset(void)
+{
+	memset(minuteBins, 0, sizeof(minuteBins));
+	memset(hourBins, 0, sizeof(hourBins));
+	memset(dayBins, 0, sizeof(dayBins));
+	memset(weekdayBins, 0, sizeof(weekdayBins));
+	memset(monthBins, 0, sizeof(monthBins));
+	memset(yearBins, 0, sizeof(yearBins));
+	minuteOffset = hourOffset = dayOffset = weekdayOffset = monthOffset = yearOffset = 0;
+	zoneVotes = 0;
+	callVotes = -flagVoteLimit;
+	clearAnnouncements();
+	started = false;
+}
+
+void Accumulator::add(const uint8_t *frame, uint32_t receivedMillis)
+{
+	if (started) {
+		// Whole minutes since the previous frame, rounded
+		uint32_t minutes = (receivedMillis - lastMillis + 30000UL) / 60000UL;
+		if (minutes == 0) return;
+		if (minutes > DCFAccumulatorMaxGap) {
+			reset();
+		} else {
+			advance(minutes);
+			followZoneChange(minutes);
+		}
+	}
+	started = true;
+	lastMillis = receivedMillis;
+
+	score(minuteBins,  60,  0, minuteOffset,  FrameDecode::minuteBits(frame),  8, 7);
+	score(hourBins,    24,  0, hourOffset,    FrameDecode::hourBits(frame),    7, 6);
+	score(dayBins,     31,  1, dayOffset,     FrameDecode::dayBits(frame),     6, 0);
+	score(weekdayBins,  7,  1, weekdayOffset, FrameDecode::weekdayBits(frame), 3, 0);
+	score(monthBins,   12,  1, monthOffset,   FrameDecode::monthBits(frame),   5, 0);
+	score(yearBins,   100,  0, yearOffset,    FrameDecode::yearBits(frame),    8, 0);
+
+	uint8_t cest = FrameDecode::cestBit(frame);
+	if (cest != FrameDecode::cetBit(frame)) vote(zoneVotes, cest, zoneVoteLimit);
+	uint8_t bits = FrameDecode::flagBits(frame);
+	vote(callVotes,       bits & 0x01, flagVoteLimit);
+	vote(zoneChangeVotes, bits & 0x02, flagVoteLimit);
+	vote(leapVotes,       bits & 0x10, flagVoteLimit);
+}
+
+unsigned char Accumulator::confidence(void)
+{
+	uint8_t margin, c = 100, m;
+	best(minuteBins, 60, 0, 0, &margin);   m = confidenceOf(margin, DCFAccumulatorLock);     if (m < c) c = m;
+	best(hourBins, 24, 0, 0, &margin);     m = confidenceOf(margin, DCFAccumulatorLock);     if (m < c) c = m;
+	best(dayBins, 31, 0, 0, &margin);      m = confidenceOf(margin, DCFAccumulatorDateLock); if (m < c) c = m;
+	best(weekdayBins, 7, 0, 0, &margin);   m = confidenceOf(margin, DCFAccumulatorDateLock); if (m < c) c = m;
+	best(monthBins, 12, 0, 0, &margin);    m = confidenceOf(margin, DCFAccumulatorDateLock); if (m < c) c = m;
+	best(yearBins, 100, 0, 0, &margin);    m = confidenceOf(margin, DCFAccumulatorDateLock); if (m < c) c = m;
+	if (zoneVotes == 0) c = 0;
+	return c;
+}
+
+bool Accumulator::locked(void)
+{
+	if (confidence() < 100) return false;
+	// The weekday is transmitted separately from the date: cross check
+	FrameDecode::Fields f;
+	fields(f);
+	if (f.time.Day > monthLength(f.time.Month, f.time.Year + 70)) return false;
+	time_t t = FrameDecode::toTime(f);
+	uint8_t dcfWeekday = (dayOfWeek(t) + 5) % 7 + 1;   // Time: Sunday = 1, DCF77: Monday = 1
+	return dcfWeekday == f.time.Wday;
+}
+
+time_t Accumulator::time(void)
+{
+	FrameDecode::Fields f;
+	fields(f);
+	return FrameDecode::toTime(f);
+}
+
+unsigned char Accumulator::CEST(void)
+{
+	return zoneVotes > 0;
+}
+
+unsigned char Accumulator::flags(void)
+{
+	return (callVotes       >= DCFAccumulatorFlagMargin ? 0x01 : 0)
+	     | (zoneChangeVotes >= DCFAccumulatorFlagMargin ? 0x02 : 0)
+	     | (zoneVotes > 0 ? 0x04 : 0) | (zoneVotes < 0 ? 0x08 : 0)
+	     | (leapVotes       >= DCFAccumulatorFlagMargin ? 0x10 : 0);
+}
+
+#endif
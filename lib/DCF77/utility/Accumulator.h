@@ -0,0 +1,78 @@
+#ifndef Accumulator_h
+#define Accumulator_h
+
+#if ARDUINO >= 100
+#include <Arduino.h> 
+#else
+#include <WProgram.h> 
+#endif
+#include <Time.h>
+#include "FrameDecode.h"
+
+/*
+  Multi-frame decoder for noisy reception (compile with DCF_ACCUMULATOR).
+
+  Every field keeps one score per possible value. A received frame is
+  compared against what each candidate predicts for this minute (the
+  minute candidates advance by one per minute, hours/days carry when the
+  best minute/hour rolls over, and days carry into the month and year
+  at the end of the best month) and each candidate gains the number of
+  matching bits, parity bits included. Bit errors in single frames only
+  cost a little score, so the right value wins after a few minutes even
+  when hardly any frame is error free. Lock requires every field to lead
+  its runner-up by a margin and the weekday to match the date.
+
+  The zone, call and announcement bits have no parity; each has a vote
+  that a frame moves up or down by one. The zone follows the sign of its
+  vote, the other bits only count once theirs reaches
+  DCFAccumulatorFlagMargin. Announcements hold for the hour they are
+  sent in, so their votes start over with every hour.
+*/
+
+#define DCFAccumulatorLock     6   // Score margin needed for minute and hour
+#define DCFAccumulatorDateLock 3   // Score margin needed for the date fields
+#define DCFAccumulatorMaxGap   (24*60) // Minutes without frames before starting over
+#define DCFAccumulatorFlagMargin 2 // Votes needed for the call and announcement bits
+
+#ifdef DCF_ACCUMULATOR
+class Accumulator {
+public:
+	Accumulator();
+	void reset(void);
+	// Add a 59 bit frame that ended at the given millis()
+	void add(const uint8_t *frame, uint32_t receivedMillis);
+	// All fields decided and consistent
+	bool locked(void);
+	// Local time of the most recently added frame and its zone
+	time_t time(void);
+	unsigned char CEST(void);
+	// Call bit, announcements and zone as decided by the votes, laid out
+	// like FrameDecode::flagBits()
+	unsigned char flags(void);
+	// Smallest margin over all fields relative to its lock threshold, 0..100
+	unsigned char confidence(void);
+
+private:
+	// Scores per candidate value. A minute candidate h stands for the value
+	// (h + minuteOffset) % 60 in the current minute, and likewise for the
+	// other rotating fields, so advancing time never moves the scores.
+	uint8_t minuteBins[60];
+	uint8_t hourBins[24];
+	uint8_t dayBins[31];
+	uint8_t weekdayBins[7];
+	uint8_t monthBins[12];
+	uint8_t yearBins[100];
+	uint8_t minuteOffset, hourOffset, dayOffset, weekdayOffset, monthOffset, yearOffset;
+	int8_t  zoneVotes;           // > 0 CEST, < 0 CET
+	int8_t  callVotes, zoneChangeVotes, leapVotes;   // > 0 set, < 0 not set
+	uint32_t lastMillis;
+	bool    started;
+
+	void fields(FrameDecode::Fields &f);
+	void advance(uint16_t minutes);
+	void clearAnnouncements(void);
+	void followZoneChange(uint16_t minutes);
+};
+#endif
+
+#endif
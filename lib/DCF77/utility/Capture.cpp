@@ -0,0 +1,90 @@
+#include "Capture.h"
+
+#ifdef DCF_CAPTURE
+
+#include "Utils.h"
+
+namespace Capture {
+
+	static volatile uint16_t ring[CAPTURE_RING_SIZE];
+	static volatile uint8_t  head = 0;
+	static volatile uint8_t  tail = 0;
+	static volatile uint16_t droppedRecords = 0;
+	static uint32_t          lastMs = 0;
+	static uint32_t          startMs = 0;
+	static bool              headerPending = false;
+
+	static bool push(uint16_t rec)
+	{
+		uint8_t next = (head + 1) & (CAPTURE_RING_SIZE - 1);
+		if (next == tail) {
+			droppedRecords++;
+			return false;
+		}
+		ring[head] = rec;
+		head = next;
+		return true;
+	}
+
+	/**
+	 * Restart the stream; the next flush() sends a fresh header
+	 */
+	void begin(uint32_t ms)
+	{
+		head = tail = 0;
+		droppedRecords = 0;
+		lastMs = startMs = ms;
+		headerPending = true;
+	}
+
+	/**
+	 * Store one edge. Called from the interrupt handler, constant time apart
+	 * from one filler record per 32 s of silence.
+	 */
+	void record(uint32_t ms, uint8_t level)
+	{
+		uint32_t delta = ms - lastMs;
+		while (delta >= CAPTURE_OVERFLOW) {
+			if (!push(CAPTURE_OVERFLOW)) return;
+			delta  -= CAPTURE_OVERFLOW;
+			lastMs += CAPTURE_OVERFLOW;
+		}
+		// A dropped record keeps lastMs, so the next delta still adds up
+		if (push((uint16_t)delta | (level ? CAPTURE_LEVEL_BIT : 0))) {
+			lastMs = ms;
+		}
+	}
+
+	/**
+	 * Write pending records to Serial, as far as its TX buffer has room
+	 */
+	void flush(void)
+	{
+		if (headerPending) {
+			if (Serial.availableForWrite() < CAPTURE_HEADER_SIZE) return;
+			uint8_t header[CAPTURE_HEADER_SIZE] = {
+				captureMagic[0], captureMagic[1], captureMagic[2], captureMagic[3],
+				CAPTURE_VERSION,
+				(uint8_t)startMs, (uint8_t)(startMs >> 8),
+				(uint8_t)(startMs >> 16), (uint8_t)(startMs >> 24)};
+			Serial.write(header, CAPTURE_HEADER_SIZE);
+			headerPending = false;
+		}
+		while (tail != head && Serial.availableForWrite() >= 2) {
+			uint16_t rec = ring[tail];
+			Serial.write((uint8_t)rec);
+			Serial.write((uint8_t)(rec >> 8));
+			tail = (tail + 1) & (CAPTURE_RING_SIZE - 1);
+		}
+	}
+
+	uint16_t dropped(void)
+	{
+		uint8_t sreg = intDisable();
+		uint16_t n = droppedRecords;
+		intRestore(sreg);
+		return n;
+	}
+}
+
+#endif
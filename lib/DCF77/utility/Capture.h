@@ -0,0 +1,41 @@
+#ifndef Capture_h
+#define Capture_h
+
+#include <stdint.h>
+
+/*
+  Raw edge capture for offline replay (compile with DCF_CAPTURE).
+
+  Stream layout, little endian:
+    header   'D' 'C' 'F' 'E', version, uint32 millis() at Start()
+    record   uint16: bit 15 = pin level after the edge,
+                     bits 0-14 = ms since the previous record
+  A record with delta CAPTURE_OVERFLOW and level 0 carries 32767 ms
+  without an edge, so arbitrarily long gaps stay exact.
+  The interrupt handler only stores records in a small ring; the main loop
+  writes them out with Capture::flush() without ever blocking on Serial.
+*/
+
+#define CAPTURE_VERSION     1
+#define CAPTURE_HEADER_SIZE 9
+#define CAPTURE_LEVEL_BIT   0x8000
+#define CAPTURE_DELTA_MASK  0x7FFF
+#define CAPTURE_OVERFLOW    0x7FFF
+#define CAPTURE_RING_SIZE   32      // records, power of two
+
+static const uint8_t captureMagic[4] = {'D', 'C', 'F', 'E'};
+
+#ifdef DCF_CAPTURE
+#ifdef DCF_VERBOSE_DEBUG
+#error "DCF_CAPTURE and DCF_VERBOSE_DEBUG both write to Serial; enable only one"
+#endif
+
+namespace Capture {
+	void begin(uint32_t ms);
+	void record(uint32_t ms, uint8_t level);
+	void flush(void);
+	uint16_t dropped(void);
+}
+#endif
+
+#endif
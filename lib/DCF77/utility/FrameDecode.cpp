@@ -0,0 +1,106 @@
+#include "FrameDecode.h"
+
+namespace FrameDecode {
+
+	// Parity of every nibble value, bit n of the word is the parity of n
+	static const uint16_t nibbleParity = 0x6996;
+
+	// Tens of a BCD byte (upper nibble), 0xFF marks an invalid digit
+	static const uint8_t bcdTens[16] = {
+		0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+	};
+
+	// Days before the first of each month in a non-leap year
+	static const uint16_t daysBeforeMonth[12] = {
+		0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+	};
+
+	static inline uint8_t parity8(uint8_t x)
+	{
+		x ^= x >> 4;
+		return (nibbleParity >> (x & 0x0F)) & 1;
+	}
+
+	// BCD to binary, 0xFF when a digit is out of range
+	static inline uint8_t bcd(uint8_t v)
+	{
+		uint8_t tens = bcdTens[v >> 4];
+		if (tens == 0xFF || (v & 0x0F) > 9) return 0xFF;
+		return tens + (v & 0x0F);
+	}
+
+	/**
+	 * Parity of each field. XOR of the bytes that make up a field keeps its
+	 * parity, so each field folds to one byte before the table lookup.
+	 */
+	bool paritiesOk(const uint8_t *frame)
+	{
+		// Minute: bits 21-28
+		if (parity8((frame[2] & 0xE0) ^ (frame[3] & 0x1F))) return false;
+		// Hour: bits 29-35
+		if (parity8((frame[3] & 0xE0) ^ (frame[4] & 0x0F))) return false;
+		// Date: bits 36-58
+		if (parity8((frame[4] & 0xF0) ^ frame[5] ^ frame[6] ^ (frame[7] & 0x07))) return false;
+		return true;
+	}
+
+	void repair(uint8_t *frame, uint8_t bit)
+	{
+		uint8_t &b = frame[bit >> 3];
+		uint8_t mask = 1 << (bit & 7);
+		b &= ~mask;
+		if (bit == 20) {
+			// Start of time, always set
+			b |= mask;
+		} else if (bit == 17 || bit == 18) {
+			// CEST and CET are each other's complement
+			if (!(bit == 17 ? cetBit(frame) : cestBit(frame))) b |= mask;
+		} else if (bit > 20 && !paritiesOk(frame)) {
+			// Only the field of this bit can be off
+			b |= mask;
+		}
+	}
+
+	bool decode(const uint8_t *frame, Fields &fields)
+	{
+		if (!paritiesOk(frame)) return false;
+
+		fields.CEST  = cestBit(frame);
+		fields.CET   = cetBit(frame);
+		fields.flags = flagBits(frame);
+		if (fields.CEST == fields.CET) return false;
+
+		uint8_t minute = bcd(minuteBits(frame) & 0x7F);
+		uint8_t hour   = bcd(hourBits(frame) & 0x3F);
+		uint8_t day    = bcd(dayBits(frame));
+		uint8_t wday   = weekdayBits(frame);
+		uint8_t month  = bcd(monthBits(frame));
+		uint8_t year   = bcd(yearBits(frame));
+
+		if (minute > 59 || hour > 23 || day < 1 || day > 31 ||
+		    month < 1 || month > 12 || year > 99) return false;
+
+		fields.time.Second = 0;
+		fields.time.Minute = minute;
+		fields.time.Hour   = hour;
+		fields.time.Wday   = wday == 7 ? 1 : wday + 1;   // DCF77 Monday=1..Sunday=7, Time Sunday=1
+		fields.time.Day    = day;
+		fields.time.Month  = month;
+		fields.time.Year   = 2000 + year - 1970;
+		return true;
+	}
+
+	time_t toTime(const Fields &fields)
+	{
+		// Every fourth year is a leap year between 2000 and 2099
+		uint8_t  year = fields.time.Year - 30;      // years since 2000
+		uint32_t days = 10957UL                     // 1970-01-01 .. 2000-01-01
+		              + 365UL * year + (year + 3) / 4
+		              + daysBeforeMonth[fields.time.Month - 1]
+		              + (fields.time.Month > 2 && (year & 3) == 0)
+		              + fields.time.Day - 1;
+		return (time_t)(days * SECS_PER_DAY
+		              + fields.time.Hour * SECS_PER_HOUR
+		              + fields.time.Minute * SECS_PER_MIN);
+	}
+}
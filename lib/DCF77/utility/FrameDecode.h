@@ -0,0 +1,57 @@
+#ifndef FrameDecode_h
+#define FrameDecode_h
+
+#if ARDUINO >= 100
+#include <Arduino.h> 
+#else
+#include <WProgram.h> 
+#endif
+#include <Time.h>
+
+/*
+  Byte-wise decoding of a received 59 bit DCF77 frame (layout as in
+  DCF77::DCF77Buffer, bit 0 = second 0, stored little endian).
+
+  Fields are cut out of the frame bytes with masks and shifts instead of
+  64 bit shifts, parities are checked by folding each field to a nibble
+  and looking it up in a 16 entry table, and BCD is converted with a
+  tens table. No loops, no 64 bit arithmetic, no division.
+*/
+
+namespace FrameDecode {
+	// Result of decoding one frame
+	struct Fields {
+		tmElements_t time;     // CET/CEST local time, Second = 0
+		unsigned char CEST;
+		unsigned char CET;
+		unsigned char flags;   // bits 15-19, see DCFFlag* in DCF77.h
+	};
+
+	// Raw field bits straight from the frame, parity bit on top where the
+	// field has its own (minute: P1 as bit 7, hour: P2 as bit 6)
+	inline uint8_t minuteBits(const uint8_t *f)  { return (f[2] >> 5) | ((f[3] & 0x1F) << 3); } // bits 21-28
+	inline uint8_t hourBits(const uint8_t *f)    { return (f[3] >> 5) | ((f[4] & 0x0F) << 3); } // bits 29-35
+	inline uint8_t dayBits(const uint8_t *f)     { return (f[4] >> 4) | ((f[5] & 0x03) << 4); } // bits 36-41
+	inline uint8_t weekdayBits(const uint8_t *f) { return (f[5] >> 2) & 0x07; }                 // bits 42-44
+	inline uint8_t monthBits(const uint8_t *f)   { return (f[5] >> 5) | ((f[6] & 0x03) << 3); } // bits 45-49
+	inline uint8_t yearBits(const uint8_t *f)    { return (f[6] >> 2) | ((f[7] & 0x03) << 6); } // bits 50-57
+	inline uint8_t cestBit(const uint8_t *f)     { return (f[2] >> 1) & 1; }                    // bit 17
+	inline uint8_t cetBit(const uint8_t *f)      { return (f[2] >> 2) & 1; }                    // bit 18
+	// Call bit, A1, CEST, CET and A2 as bits 0-4; none of them is parity protected
+	inline uint8_t flagBits(const uint8_t *f)    { return (f[1] >> 7) | ((f[2] & 0x0F) << 1); } // bits 15-19
+
+	// True when minute, hour and date each have even parity including
+	// their parity bit (P1, P2, P3)
+	bool paritiesOk(const uint8_t *frame);
+	// Fill in the one bit (15-58) that was not received: from the parity
+	// of its field, from the other zone bit, or as not set for the flags.
+	// The parity of a repaired field checks nothing any more
+	void repair(uint8_t *frame, uint8_t bit);
+	// Decode time and zone; false if parity, zone bits or BCD ranges are invalid
+	bool decode(const uint8_t *frame, Fields &fields);
+	// Same result as makeTime(fields.time) for years 2000-2099, without the
+	// per-year and per-month loops
+	time_t toTime(const Fields &fields);
+}
+
+#endif
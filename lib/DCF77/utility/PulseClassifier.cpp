@@ -0,0 +1,171 @@
+#include "PulseClassifier.h"
+#include <DCF77.h>
+#include "Utils.h"
+
+static const uint16_t invertedWidth = 500;
+static const uint16_t defaultMaxWidth = PulseBins << PulseBinShift;
+
+void PulseClassifier::defaults(void)
+{
+	memset(histogram, 0, sizeof(histogram));
+	samples     = 0;
+	sinceUpdate = 0;
+	rejects     = 0;
+	learned     = false;
+	shortWidth  = 100;
+	longWidth   = 200;
+	split       = DCFSplitTime;
+	minWidth    = DCFRejectPulseWidth;
+	maxWidth    = defaultMaxWidth;
+	second      = 1000;
+	secondDeviation = 0;
+	intervals   = 0;
+}
+
+/**
+ * Use the clusters at m0 and m1 ms from here on
+ */
+void PulseClassifier::apply(uint16_t m0, uint16_t m1)
+{
+	shortWidth = m0;
+	longWidth  = m1;
+	split      = (m0 + m1) / 2;
+	minWidth   = m0 / 2;
+	maxWidth   = m1 + (m1 - m0);
+	if (maxWidth > defaultMaxWidth) maxWidth = defaultMaxWidth;
+	learned    = true;
+}
+
+/**
+ * Locate the short and long clusters by two-means on the histogram
+ * and derive split and acceptance range from them
+ */
+void PulseClassifier::learn(void)
+{
+	uint8_t t = split >> PulseBinShift;
+	uint16_t m0 = 0, m1 = 0;
+	for (uint8_t iteration = 0; iteration < 4; iteration++) {
+		uint32_t s0 = 0, s1 = 0;
+		uint16_t w0 = 0, w1 = 0;
+		for (uint8_t i = 0; i < PulseBins; i++) {
+			uint16_t center = (i << PulseBinShift) + (1 << (PulseBinShift - 1));
+			if (i < t) { w0 += histogram[i]; s0 += (uint32_t)histogram[i] * center; }
+			else       { w1 += histogram[i]; s1 += (uint32_t)histogram[i] * center; }
+		}
+		// Both bit values are needed to tell where they separate
+		if (w0 == 0 || w1 == 0) return;
+		m0 = s0 / w0;
+		m1 = s1 / w1;
+		uint8_t next = ((m0 + m1) / 2) >> PulseBinShift;
+		if (next == t) break;
+		t = next;
+	}
+	if (m1 < m0 + 40) return;    // One smeared cluster, not two
+	apply(m0, m1);
+}
+
+PulseClassifier::PulseClassifier()
+{
+	reset();
+}
+
+void PulseClassifier::reset(void)
+{
+	uint8_t sreg = intDisable();
+	defaults();
+	invertedRun = 0;
+	inverted    = false;
+	intRestore(sreg);
+}
+
+bool PulseClassifier::seed(uint16_t shortMs, uint16_t longMs, bool invert)
+{
+	uint8_t sreg = intDisable();
+	defaults();
+	invertedRun = 0;
+	inverted    = invert;
+	// The same plausibility as for learned clusters
+	bool valid = shortMs >= DCFRejectPulseWidth && longMs >= shortMs + 40 && longMs < defaultMaxWidth;
+	if (valid) apply(shortMs, longMs);
+	intRestore(sreg);
+	return valid;
+}
+
+int8_t PulseClassifier::pulse(uint16_t width)
+{
+	if (width >= invertedWidth) {
+		// The pause instead of the pulse: receiver output is inverted
+		if (++invertedRun >= PulseInvertCount) {
+			invertedRun = 0;
+			inverted = !inverted;
+			defaults();
+			return PulseInverted;
+		}
+		return PulseReject;
+	}
+	invertedRun = 0;
+
+	if (width < minWidth || width >= maxWidth) {
+		if (++rejects >= PulseRelearnCount) {
+			// Learned values do not fit this receiver (any more)
+			defaults();
+		}
+		return PulseReject;
+	}
+	rejects = 0;
+
+	uint8_t bin = width >> PulseBinShift;
+	if (++histogram[bin] == 255) {
+		// Keep headroom; halving fades old pulses
+		for (uint8_t i = 0; i < PulseBins; i++) histogram[i] >>= 1;
+	}
+	if (samples < 0xFFFF) samples++;
+	if (++sinceUpdate >= 8 && samples >= PulseLearnCount) {
+		sinceUpdate = 0;
+		learn();
+	}
+	return width < split ? 0 : 1;
+}
+
+void PulseClassifier::interval(uint16_t ms)
+{
+	// Only plain seconds, not the minute gap or missed pulses
+	if (ms <= DCFRejectionTime || ms >= DCFSyncTime) return;
+	int16_t error = (int16_t)ms - (int16_t)second;
+	second += error / 8;
+	secondDeviation += ((int16_t)abs(error) - (int16_t)secondDeviation) / 8;
+	if (intervals < PulseLearnCount) intervals++;
+}
+
+uint16_t PulseClassifier::minGap(void)
+{
+	if (intervals < PulseLearnCount) return DCFRejectionTime;
+	// Keep well clear of jitter; never tighter than 100 ms before the edge
+	uint16_t margin = 4 * secondDeviation + 20;
+	if (margin < 100) margin = 100;
+	if (margin > second - DCFRejectionTime) margin = second - DCFRejectionTime;
+	return second - margin;
+}
+
+uint16_t PulseClassifier::syncGap(void)
+{
+	if (intervals < PulseLearnCount) return DCFSyncTime;
+	return second + second / 2;
+}
+
+void PulseClassifier::parameters(Parameters &p)
+{
+	uint8_t sreg = intDisable();
+	p.shortWidth = shortWidth;
+	p.longWidth  = longWidth;
+	p.split      = split;
+	p.minWidth   = minWidth;
+	p.maxWidth   = maxWidth;
+	p.second     = second;
+	p.samples    = samples;
+	p.learned    = learned;
+	p.inverted   = inverted;
+	p.minGap     = minGap();
+	p.syncGap    = syncGap();
+	intRestore(sreg);
+}
@@ -0,0 +1,85 @@
+#ifndef PulseClassifier_h
+#define PulseClassifier_h
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/*
+  Online classification of DCF77 pulses, learned from the receiver at hand.
+
+  Pulse widths go into a histogram of 8 ms bins. Every few pulses the
+  short and long clusters are located by two-means on the histogram; the
+  split lies halfway between them and pulses far outside both clusters are
+  rejected. The interval between the leading edges of consecutive seconds
+  is tracked with its mean deviation, which gives the earliest plausible
+  next leading edge and the gap that marks the end of a minute.
+
+  Until enough pulses have been seen the fixed defaults from DCF77.h
+  apply, or the clusters given to seed(); fresh pulses replace those as
+  soon as there are enough of them. A long run of rejected pulses (different receiver, wrong
+  polarity) drops what was learned. Pulses of 500 ms and more are what an
+  inverted receiver delivers: after a run of those the classifier reports
+  that the polarity should be flipped.
+*/
+
+#define PulseBinShift     3      // 8 ms histogram bins
+#define PulseBins         40     // up to 320 ms
+#define PulseLearnCount   16     // Accepted pulses before learned values apply
+#define PulseRelearnCount 16     // Consecutive rejects that drop learned values
+#define PulseInvertCount  8      // Consecutive >= 500 ms pulses before flipping
+
+#define PulseReject   -1
+#define PulseInverted -2
+
+class PulseClassifier {
+public:
+	struct Parameters {
+		uint16_t shortWidth;   // ms, center of the short (0) cluster
+		uint16_t longWidth;    // ms, center of the long (1) cluster
+		uint16_t split;        // ms, shorter pulses are 0
+		uint16_t minWidth;     // ms, shorter pulses are rejected
+		uint16_t maxWidth;     // ms, longer pulses are rejected
+		uint16_t second;       // ms, mean interval between seconds
+		uint16_t minGap;       // ms, earlier leading edges are rejected
+		uint16_t syncGap;      // ms, longer gaps mark the minute
+		uint16_t samples;      // pulses in the histogram
+		bool     learned;
+		bool     inverted;     // polarity flipped relative to the constructor
+	};
+
+	PulseClassifier();
+	void reset(void);
+	// Start from clusters learned before, e.g. before a reset, and the
+	// polarity they were learned with; false when they are implausible
+	bool seed(uint16_t shortMs, uint16_t longMs, bool invert);
+	// Classify a pulse width: 0, 1, PulseReject or PulseInverted
+	int8_t pulse(uint16_t width);
+	// Interval between two accepted leading edges
+	void interval(uint16_t ms);
+	uint16_t minGap(void);
+	uint16_t syncGap(void);
+	void parameters(Parameters &p);
+
+private:
+	// Written in the interrupt handler only; read elsewhere with interrupts off
+	uint8_t  histogram[PulseBins];
+	uint16_t samples;
+	uint8_t  sinceUpdate;
+	uint8_t  rejects;
+	uint8_t  invertedRun;
+	bool     learned;
+	bool     inverted;
+
+	uint16_t shortWidth, longWidth, split, minWidth, maxWidth;
+	uint16_t second, secondDeviation;
+	uint8_t  intervals;
+
+	void defaults(void);
+	void apply(uint16_t m0, uint16_t m1);
+	void learn(void);
+};
+
+#endif
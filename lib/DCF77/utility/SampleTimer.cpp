@@ -0,0 +1,65 @@
+#include "SampleTimer.h"
+
+#ifdef DCF_SAMPLED
+
+#if defined(NATIVE)
+#include <Arduino.h>
+#include <SimHAL.h>
+#else
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#endif
+
+namespace SampleTimer {
+
+	static void (*volatile sampleHandler)(void) = 0;
+
+#if defined(NATIVE)
+
+	void begin(uint16_t rateHz, void (*handler)(void))
+	{
+		sampleHandler = handler;
+		Sim::attachTimer(1000000UL / rateHz, handler);
+	}
+
+	void end(void)
+	{
+		Sim::detachTimer();
+		sampleHandler = 0;
+	}
+
+#else
+
+	void begin(uint16_t rateHz, void (*handler)(void))
+	{
+		uint8_t sreg = SREG;
+		cli();
+		sampleHandler = handler;
+		TCCR1A = 0;
+		TCCR1B = 0;
+		TCNT1  = 0;
+		OCR1A  = (F_CPU / 64) / rateHz - 1;
+		TCCR1B = (1 << WGM12) | (1 << CS11) | (1 << CS10);   // CTC, clk/64
+		TIFR1  = (1 << OCF1A);
+		TIMSK1 |= (1 << OCIE1A);
+		SREG = sreg;
+	}
+
+	void end(void)
+	{
+		TIMSK1 &= ~(1 << OCIE1A);
+		TCCR1B = 0;
+		sampleHandler = 0;
+	}
+
+#endif
+}
+
+#if !defined(NATIVE)
+ISR(TIMER1_COMPA_vect)
+{
+	if (SampleTimer::sampleHandler) SampleTimer::sampleHandler();
+}
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SampleTimer_h
+#define SampleTimer_h
+
+#include <stdint.h>
+
+/*
+  Fixed rate timer interrupt for the sampled decoder (DCF_SAMPLED).
+
+  AVR: Timer1 in CTC mode, prescaler 64 (4 us per count at 16 MHz), so
+  any rate from 100 to 1000 Hz is exact. Timer1 drives PWM on pins 9 and
+  10; those cannot be used with analogWrite() while sampling.
+  NATIVE: the simulated timer of the host HAL.
+*/
+
+#ifdef DCF_SAMPLED
+namespace SampleTimer {
+	void begin(uint16_t rateHz, void (*handler)(void));
+	void end(void);
+}
+#endif
+
+#endif
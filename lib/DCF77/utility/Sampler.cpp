@@ -0,0 +1,211 @@
+#include "Sampler.h"
+
+#ifdef DCF_SAMPLED
+
+#include "PulseClassifier.h"
+#include "SignalQuality.h"
+#include "Utils.h"
+
+static const uint8_t samplesPerSlot = DCFSampleRate / 100;
+static const uint8_t binHigh = 248;   // Steady state of a slot that is always active
+static const uint16_t samplePeriod = 1000000UL / DCFSampleRate;
+// A slot is active when the edge came before its majority sample, and the
+// integrator delays edges by DCFSampleFilter - 1 samples; slots are
+// accounted as if active from their start. Mean error of that, us.
+static const int16_t edgeBias = (samplesPerSlot - samplesPerSlot / 2) * samplePeriod
+                                - 5000 - (DCFSampleFilter - 1) * samplePeriod;
+
+/**
+ * Correlation of the averaged second with low-then-high around slot p
+ */
+int16_t Sampler::correlate(uint8_t p)
+{
+	int16_t s = 0;
+	uint8_t i = p;
+	for (uint8_t k = 0; k < 10; k++) {
+		s += bins[i];
+		if (++i == SampleSlots) i = 0;
+	}
+	i = p < 10 ? p + SampleSlots - 10 : p - 10;
+	for (uint8_t k = 0; k < 10; k++) {
+		s -= bins[i];
+		if (++i == SampleSlots) i = 0;
+	}
+	return s;
+}
+
+uint8_t Sampler::slotAt(int8_t delta)
+{
+	int16_t i = (int16_t)boundary + delta;
+	if (i < 0) i += SampleSlots;
+	if (i >= SampleSlots) i -= SampleSlots;
+	return i;
+}
+
+/**
+ * Position of the edge relative to the start of the boundary slot, us.
+ * Jitter smears the edge over the slots around the boundary; their
+ * averaged activity, scaled between the pause and the pulse level
+ * (the minute gap keeps the latter below binHigh), says how much of
+ * them lies after the edge.
+ */
+int16_t Sampler::fraction(void)
+{
+	int16_t low  = bins[slotAt(-6)];
+	int16_t high = bins[slotAt(4)];
+	if (high - low < 64) return edgeBias;
+	int32_t active = 0;
+	for (int8_t k = -2; k < 2; k++) {
+		int16_t b = bins[slotAt(k)];
+		if (b < low) b = low;
+		if (b > high) b = high;
+		active += b - low;
+	}
+	// Two slots after the boundary slot start, minus the active time
+	return 20000L - active * 10000L / (high - low) + edgeBias;
+}
+
+/**
+ * End of a sweep over all candidate boundaries
+ */
+void Sampler::commit(void)
+{
+	// Pulses cover at most a fifth of the second; active most of the time
+	// means the receiver output is inverted. The correlation alone can not
+	// tell: the end of a pulse scores almost as low as its start scores high
+	uint16_t total = 0;
+	for (uint8_t i = 0; i < SampleSlots; i++) total += bins[i];
+	if (total > SampleSlots / 2 * binHigh) {
+		// Pulses are high where pauses should be: flip what counts as active
+		invert = !invert;
+		for (uint8_t i = 0; i < SampleSlots; i++) bins[i] = bins[i] > binHigh ? 0 : binHigh - bins[i];
+		boundary = worstSlot;
+		boundaryScore = -worstScore;
+		valid = boundaryScore >= SampleMinScore;
+	} else if (bestScore < SampleMinScore) {
+		valid = false;
+		boundaryScore = bestScore > 0 ? bestScore : 0;
+	} else if (!valid || bestScore > currentScore + SampleHysteresis) {
+		boundary = bestSlot;
+		boundaryScore = bestScore;
+		valid = true;
+	} else {
+		boundaryScore = currentScore;
+	}
+	bestScore = worstScore = 0;
+}
+
+Sampler::Sampler()
+{
+	reset();
+}
+
+void Sampler::reset(void)
+{
+	uint8_t sreg = intDisable();
+	memset(bins, 0, sizeof(bins));
+	slot = subSample = slotActive = 0;
+	integrator = 0;
+	filtered = false;
+	invert = false;
+	bestScore = worstScore = currentScore = 0;
+	bestSlot = worstSlot = 0;
+	boundary = 0;
+	valid = false;
+	boundaryScore = 0;
+	pulseSlots = gapSlots = 0;
+	lastOffset = 0;
+	reported = true;
+	intRestore(sreg);
+}
+
+int8_t Sampler::sample(uint8_t active, PulseClassifier &pulses, SignalQuality &quality)
+{
+	// Integrator: follow the input only after DCFSampleFilter agreeing samples
+	if (active ^ invert) {
+		if (integrator < DCFSampleFilter) integrator++;
+		if (integrator == DCFSampleFilter) filtered = true;
+	} else {
+		if (integrator > 0) integrator--;
+		if (integrator == 0) filtered = false;
+	}
+	slotActive += filtered;
+	if (++subSample < samplesPerSlot) return SampleIdle;
+
+	// End of a 10 ms slot
+	subSample = 0;
+	bool level = 2 * slotActive > samplesPerSlot;
+	slotActive = 0;
+	bins[slot] = bins[slot] - (bins[slot] >> 3) + (level ? 31 : 0);
+
+	// Candidate whose 200 ms window ends with this slot, all of it fresh
+	uint8_t candidate = slot >= 9 ? slot - 9 : slot + SampleSlots - 9;
+	int16_t s = correlate(candidate);
+	if (s > bestScore)  { bestScore = s;  bestSlot = candidate; }
+	if (s < worstScore) { worstScore = s; worstSlot = candidate; }
+	if (candidate == boundary) currentScore = s;
+
+	int8_t result = SampleIdle;
+	if (valid) {
+		uint8_t offset = slot >= boundary ? slot - boundary : slot + SampleSlots - boundary;
+		// A moved boundary may skip or repeat an offset; a wrap is a new second
+		if (offset < lastOffset) {
+			pulseSlots = gapSlots = 0;
+			reported = false;
+		}
+		lastOffset = offset;
+		if (offset < SampleWindow) {
+			// The pulse is the run of active slots from the boundary: a single
+			// dropout inside it is bridged, activity after it is a spike
+			if (gapSlots < 2) {
+				if (level) {
+					pulseSlots += 1 + gapSlots;
+					gapSlots = 0;
+				} else if (pulseSlots) {
+					gapSlots++;
+				}
+			}
+		} else if (!reported) {
+			reported = true;
+			// This slot ended now, the boundary slot started offset + 1 slots ago
+			reportedMicros = micros() - (offset + 1) * 10000UL + fraction();
+			if (pulseSlots < SampleMinPulse) {
+				result = SampleNoPulse;
+			} else {
+				quality.width(pulseSlots * 10);
+				result = pulses.pulse(pulseSlots * 10);
+			}
+		}
+	}
+
+	if (++slot == SampleSlots) {
+		slot = 0;
+		commit();
+	}
+	return result;
+}
+
+uint32_t Sampler::secondMicros(void)
+{
+	return reportedMicros;
+}
+
+bool Sampler::locked(void)
+{
+	return valid;
+}
+
+bool Sampler::inverted(void)
+{
+	return invert;
+}
+
+int16_t Sampler::score(void)
+{
+	uint8_t sreg = intDisable();
+	int16_t s = boundaryScore;
+	intRestore(sreg);
+	return s;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef Sampler_h
+#define Sampler_h
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/*
+  Sampled DCF77 acquisition (compile with DCF_SAMPLED).
+
+  A timer samples the receiver pin at DCFSampleRate. Samples pass an
+  integrator (debounce/low-pass: the output only follows the input after
+  DCFSampleFilter agreeing samples) and are folded into 10 ms slots. Each
+  slot keeps an exponential average of its level over past seconds, so
+  one second of history costs 100 bytes whatever the sample rate.
+
+  The second boundary is where the averaged second correlates best with
+  "low for 100 ms, then high for 100 ms". The correlator evaluates one
+  candidate per slot (20 additions) and commits the best of a full sweep
+  once per second. A second that is active most of the time means the
+  receiver output is inverted. Relative to the boundary the run of active
+  slots within the first 250 ms gives the pulse width, which
+  PulseClassifier turns into a bit.
+
+  Work per timer interrupt is bounded and independent of the signal:
+  glitches on the antenna cost nothing extra.
+*/
+
+#ifndef DCFSampleRate
+#define DCFSampleRate     100    // Hz, multiple of 100 up to 1000
+#endif
+#ifndef DCFSampleFilter
+#define DCFSampleFilter   (DCFSampleRate / 250 + 1)   // Integrator length, samples
+#endif
+
+#if DCFSampleRate < 100 || DCFSampleRate > 1000 || DCFSampleRate % 100
+#error "DCFSampleRate must be a multiple of 100 Hz between 100 and 1000"
+#endif
+
+#define SampleSlots       100    // 10 ms slots per second
+#define SampleWindow      25     // Slots after the boundary that may hold the pulse
+#define SampleMinPulse    4      // Active slots below this: no pulse in this second
+#define SampleMinScore    800    // Correlation needed to trust a boundary (max 2480)
+#define SampleHysteresis  100    // Score a new boundary must gain over the current
+
+#define SampleIdle    -3         // Nothing to report for this sample
+#define SampleNoPulse -4         // A second without pulse (minute mark or dropout)
+
+#ifdef DCF_SAMPLED
+class PulseClassifier;
+class SignalQuality;
+
+class Sampler {
+public:
+	Sampler();
+	void reset(void);
+	// One pin sample, active = receiver reports carrier reduction. The
+	// pulse width of each second goes to quality and is classified by
+	// pulses. Returns SampleIdle, SampleNoPulse, PulseReject, or the bit
+	// 0/1 once per second, 250 ms after the boundary
+	int8_t sample(uint8_t active, PulseClassifier &pulses, SignalQuality &quality);
+	// micros() of the boundary of the second just reported
+	uint32_t secondMicros(void);
+	bool locked(void);
+	bool inverted(void);
+	// Correlation at the current boundary, 0..2480
+	int16_t score(void);
+
+private:
+	uint8_t  bins[SampleSlots];
+	uint8_t  slot;            // Current slot of the free running local second
+	uint8_t  subSample;
+	uint8_t  slotActive;      // Active samples in the current slot
+	uint8_t  integrator;
+	bool     filtered;
+	bool     invert;
+
+	// Correlator sweep
+	int16_t  bestScore, worstScore, currentScore;
+	uint8_t  bestSlot, worstSlot;
+
+	// Boundary and the pulse of the current second
+	uint8_t  boundary;
+	bool     valid;
+	int16_t  boundaryScore;
+	uint8_t  pulseSlots;
+	uint8_t  gapSlots;        // Inactive slots since the pulse was last active
+	uint8_t  lastOffset;
+	bool     reported;
+	uint32_t reportedMicros;
+
+	int16_t correlate(uint8_t p);
+	uint8_t slotAt(int8_t delta);
+	int16_t fraction(void);
+	void commit(void);
+};
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+#include "SecondTracker.h"
+#include "Utils.h"
+
+static const uint32_t nominalQ4 = 1000000UL << 4;
+static const uint32_t maxDeltaQ4 = DCFTrackerMaxPpm << 4;   // 1 s * ppm * 16
+
+/**
+ * Length of n periods in us, without overflowing for long gaps
+ */
+uint32_t SecondTracker::span(unsigned int n)
+{
+	return n * (periodQ4 >> 4) + ((n * (periodQ4 & 15)) >> 4);
+}
+
+/**
+ * Take this edge as the new phase reference, keep the learned period
+ */
+void SecondTracker::restart(uint32_t edgeMicros, uint32_t edgeMillis)
+{
+	tickMicros = edgeMicros;
+	tickMillis = edgeMillis;
+	goodEdges  = 0;
+	misses     = 0;
+	started    = true;
+}
+
+SecondTracker::SecondTracker()
+{
+	reset();
+}
+
+void SecondTracker::reset(void)
+{
+	uint8_t sreg = intDisable();
+	ticks    = 0;
+	periodQ4 = nominalQ4;
+	jitterUs = 0;
+	started  = false;
+	goodEdges = 0;
+	misses   = 0;
+	intRestore(sreg);
+}
+
+uint32_t SecondTracker::edge(uint32_t edgeMicros)
+{
+	uint32_t edgeMillis = millis();
+	if (!started || edgeMillis - tickMillis > DCFTrackerMaxGap * 1000UL) {
+		// After a long gap only millis() can tell the seconds missed
+		ticks += started ? (edgeMillis - tickMillis + 500) / 1000 : 1;
+		restart(edgeMicros, edgeMillis);
+		return ticks;
+	}
+	uint32_t period  = periodQ4 >> 4;
+	uint32_t elapsed = edgeMicros - tickMicros;
+	// Whole seconds since the last tick, bridging missing pulses
+	unsigned int n = (elapsed + period / 2) / period;
+	if (n == 0) {
+		return ticks;
+	}
+	int32_t error = (int32_t)(elapsed - span(n));
+	uint32_t deviation = error < 0 ? -error : error;
+
+	if (deviation > DCFTrackerWindow) {
+		if (goodEdges >= DCFTrackerLockEdges && ++misses < DCFTrackerMaxMiss) {
+			// Locked: an outlier (noise, late spike) does not move the loop
+			return ticks + n;
+		}
+		ticks += n;
+		restart(edgeMicros, edgeMillis);
+		return ticks;
+	}
+
+	// Second order loop: pull the phase by 1/4 and the period by 1/16 of the error
+	tickMicros += span(n) + error / 4;
+	tickMillis  = edgeMillis;
+	periodQ4   += error / (int32_t)n;
+	if (periodQ4 > nominalQ4 + maxDeltaQ4) periodQ4 = nominalQ4 + maxDeltaQ4;
+	if (periodQ4 < nominalQ4 - maxDeltaQ4) periodQ4 = nominalQ4 - maxDeltaQ4;
+	jitterUs   += ((int32_t)deviation - (int32_t)jitterUs) / 8;
+	ticks      += n;
+	misses      = 0;
+	if (goodEdges < DCFTrackerLockEdges) goodEdges++;
+	return ticks;
+}
+
+bool SecondTracker::now(uint32_t &tick, uint32_t &sinceTick)
+{
+	uint8_t sreg = intDisable();
+	uint32_t at     = tickMicros;
+	uint32_t atMs   = tickMillis;
+	uint32_t last   = ticks;
+	uint32_t period = periodQ4 >> 4;
+	bool isLocked = started && goodEdges >= DCFTrackerLockEdges;
+	uint32_t elapsed = micros() - at;
+	uint32_t elapsedMs = millis() - atMs;
+	intRestore(sreg);
+
+	if (!isLocked || elapsedMs > DCFTrackerMaxGap * 1000UL) {
+		tick = last;
+		sinceTick = 0;
+		return false;
+	}
+	uint32_t n = elapsed / period;
+	tick = last + n;
+	sinceTick = elapsed - n * period;
+	return true;
+}
+
+bool SecondTracker::locked(void)
+{
+	uint32_t tick, sinceTick;
+	return now(tick, sinceTick);
+}
+
+unsigned int SecondTracker::jitter(void)
+{
+	uint8_t sreg = intDisable();
+	unsigned int j = jitterUs;
+	intRestore(sreg);
+	return j;
+}
+
+uint32_t SecondTracker::period(void)
+{
+	uint8_t sreg = intDisable();
+	uint32_t p = periodQ4;
+	intRestore(sreg);
+	return (p + 8) >> 4;
+}
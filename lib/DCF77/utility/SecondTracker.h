@@ -0,0 +1,66 @@
+#ifndef SecondTracker_h
+#define SecondTracker_h
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/*
+  Phase-locked tracking of the DCF77 second ticks.
+
+  Every accepted leading edge is timestamped with micros() in the
+  interrupt handler. The tracker predicts the next tick from the last one
+  and a learned period (the local oscillator is never exactly 1 MHz), and
+  pulls phase and period towards each measured edge with fixed gains, a
+  second order loop. Missing pulses (the minute gap, dropouts) are bridged
+  by counting whole periods, so the tick counter keeps its meaning across
+  them. Edges too far from the prediction are ignored while locked; too
+  many in a row start over.
+
+  The tick counter together with the tick of a frame's minute marker
+  gives the elapsed time since that frame with sub-millisecond resolution.
+  Times are uint32_t so that wrap-around arithmetic on micros()/millis()
+  is the same on the AVR and in the native simulation.
+  Queries extrapolate the last tick; micros() wraps after ~71 minutes, so
+  without edges for longer than DCFTrackerMaxGap the lock is dropped.
+*/
+
+#define DCFTrackerLockEdges  8      // Consecutive good edges before locked
+#define DCFTrackerWindow     40000L // Max. deviation from prediction while locked, us
+#define DCFTrackerMaxMiss    5      // Consecutive outliers before starting over
+#define DCFTrackerMaxGap     600    // Seconds without edges before unlocking
+#define DCFTrackerMaxPpm     5000L  // Period limit relative to 1 s (ceramic resonators)
+
+class SecondTracker {
+public:
+	SecondTracker();
+	void reset(void);
+	// Leading edge at the given micros(), called from the interrupt handler.
+	// Returns the number of the tick nearest to the edge, also for outliers
+	uint32_t edge(uint32_t edgeMicros);
+	// Tick count at this moment and the micros elapsed since that tick
+	bool now(uint32_t &tick, uint32_t &sinceTick);
+	bool locked(void);
+	// Smoothed deviation of the edges from the prediction, us
+	unsigned int jitter(void);
+	// Learned length of a second in micros() units
+	uint32_t period(void);
+
+private:
+	// Shared with the interrupt handler; main loop reads with interrupts off
+	uint32_t      tickMicros;     // micros() of the last tick (filtered)
+	uint32_t      tickMillis;     // millis() of the last tick, wrap guard for micros()
+	uint32_t      ticks;          // number of the last tick
+	uint32_t      periodQ4;       // period in 1/16 us
+	unsigned int  jitterUs;
+	uint8_t       goodEdges;
+	uint8_t       misses;
+	bool          started;
+
+	uint32_t span(unsigned int n);
+	void restart(uint32_t edgeMicros, uint32_t edgeMillis);
+};
+
+#endif
@@ -0,0 +1,236 @@
+#include "SignalQuality.h"
+#include "Utils.h"
+
+static const uint32_t hourMs = 3600000UL;
+
+// Cause names for report(), in flash with their table
+static const char nameMinGap[]    PROGMEM = "rCT";
+static const char nameWidth[]     PROGMEM = "rPW";
+static const char nameStray[]     PROGMEM = "stray";
+static const char nameOverflow[]  PROGMEM = "EoB";
+static const char nameShort[]     PROGMEM = "EoM";
+static const char nameHoles[]     PROGMEM = "holes";
+static const char nameQueueFull[] PROGMEM = "QF";
+static const char nameParity[]    PROGMEM = "parity";
+static const char nameNotLocked[] PROGMEM = "unlocked";
+static const char nameBounds[]    PROGMEM = "bounds";
+static const char nameLag[]       PROGMEM = "lag";
+
+static const char *const names[QualityCauses] PROGMEM = {
+	nameMinGap, nameWidth, nameStray, nameOverflow, nameShort, nameHoles,
+	nameQueueFull, nameParity, nameNotLocked, nameBounds, nameLag
+};
+
+/**
+ * Move the slot on to the hour of millis(); hours without data are
+ * cleared on the way, at most all of them
+ */
+void SignalQuality::roll(void)
+{
+	uint32_t ms = millis();
+	for (uint8_t i = 0; ms - slotStart >= hourMs; i++) {
+		if (i == DCFQualityHours) {
+			slotStart = ms;
+			break;
+		}
+		slotStart += hourMs;
+		if (++slot == DCFQualityHours) slot = 0;
+		sumFrames  -= hourFrames[slot];
+		sumMinutes -= hourMinutes[slot];
+		hourFrames[slot]  = 0;
+		hourMinutes[slot] = 0;
+	}
+}
+
+static void average(uint16_t &avg, bool good, uint8_t shift)
+{
+	int16_t target = good ? 100 << 8 : 0;
+	avg += (target - (int16_t)avg) >> shift;
+}
+
+static void count(uint16_t *counters, uint8_t n, uint8_t i)
+{
+	if (counters[i] == 0xFFFF) {
+		for (uint8_t j = 0; j < n; j++) counters[j] >>= 1;
+	}
+	counters[i]++;
+}
+
+SignalQuality::SignalQuality()
+{
+	reset();
+}
+
+void SignalQuality::reset(void)
+{
+	uint8_t sreg = intDisable();
+	memset(widths, 0, sizeof(widths));
+	memset(causes, 0, sizeof(causes));
+	memset(hourFrames, 0, sizeof(hourFrames));
+	memset(hourMinutes, 0, sizeof(hourMinutes));
+	sumFrames  = 0;
+	sumMinutes = 0;
+	slot       = 0;
+	slotStart  = millis();
+	frameAvg   = 0;
+	pulseAvg   = 0;
+	intRestore(sreg);
+}
+
+void SignalQuality::restore(uint8_t frames, uint8_t pulses)
+{
+	uint8_t sreg = intDisable();
+	frameAvg = (frames > 100 ? 100 : frames) << 8;
+	pulseAvg = (pulses > 100 ? 100 : pulses) << 8;
+	intRestore(sreg);
+}
+
+void SignalQuality::width(uint16_t widthMs)
+{
+	uint16_t bin = widthMs / DCFQualityBinMs;
+	uint8_t sreg = intDisable();
+	count(widths, DCFQualityBins, bin < DCFQualityBins ? bin : DCFQualityBins - 1);
+	intRestore(sreg);
+}
+
+void SignalQuality::pulse(void)
+{
+	uint8_t sreg = intDisable();
+	average(pulseAvg, true, DCFQualityPulseAvg);
+	intRestore(sreg);
+}
+
+void SignalQuality::reject(uint8_t cause)
+{
+	uint8_t sreg = intDisable();
+	count(causes, QualityCauses, cause);
+	if (cause < QualityPulseCauses) {
+		average(pulseAvg, false, DCFQualityPulseAvg);
+	} else {
+		average(frameAvg, false, DCFQualityFrameAvg);
+	}
+	intRestore(sreg);
+}
+
+void SignalQuality::minuteEnd(void)
+{
+	uint8_t sreg = intDisable();
+	roll();
+	if (hourMinutes[slot] != 0xFF) {
+		hourMinutes[slot]++;
+		sumMinutes++;
+	}
+	intRestore(sreg);
+}
+
+void SignalQuality::accepted(void)
+{
+	uint8_t sreg = intDisable();
+	roll();
+	if (hourFrames[slot] != 0xFF) {
+		hourFrames[slot]++;
+		sumFrames++;
+	}
+	average(frameAvg, true, DCFQualityFrameAvg);
+	intRestore(sreg);
+}
+
+uint16_t SignalQuality::histogram(uint8_t bin)
+{
+	uint8_t sreg = intDisable();
+	uint16_t n = widths[bin];
+	intRestore(sreg);
+	return n;
+}
+
+uint16_t SignalQuality::rejections(uint8_t cause)
+{
+	uint8_t sreg = intDisable();
+	uint16_t n = causes[cause];
+	intRestore(sreg);
+	return n;
+}
+
+void SignalQuality::hour(uint8_t hoursAgo, uint8_t &frames, uint8_t &minutes)
+{
+	uint8_t sreg = intDisable();
+	roll();
+	uint8_t i = slot >= hoursAgo ? slot - hoursAgo : slot + DCFQualityHours - hoursAgo;
+	frames  = hourFrames[i];
+	minutes = hourMinutes[i];
+	intRestore(sreg);
+}
+
+uint8_t SignalQuality::rate(void)
+{
+	uint8_t sreg = intDisable();
+	roll();
+	uint16_t frames = sumFrames, minutes = sumMinutes;
+	intRestore(sreg);
+	// A frame can be accepted in the next hour of its minute end
+	if (frames > minutes) frames = minutes;
+	return minutes ? (uint32_t)frames * 100 / minutes : 0;
+}
+
+uint16_t SignalQuality::minutes(void)
+{
+	uint8_t sreg = intDisable();
+	roll();
+	uint16_t n = sumMinutes;
+	intRestore(sreg);
+	return n;
+}
+
+uint8_t SignalQuality::score(void)
+{
+	uint8_t sreg = intDisable();
+	uint32_t s = 3UL * frameAvg + pulseAvg;
+	intRestore(sreg);
+	return (s / 4 + 128) >> 8;
+}
+
+void SignalQuality::averages(uint8_t &frames, uint8_t &pulses)
+{
+	uint8_t sreg = intDisable();
+	uint16_t f = frameAvg, p = pulseAvg;
+	intRestore(sreg);
+	frames = (f + 128) >> 8;
+	pulses = (p + 128) >> 8;
+}
+
+void SignalQuality::report(Print &out)
+{
+	out.print(F("quality "));
+	out.print(score());
+	out.print(F(", frames "));
+	out.print(rate());
+	out.print(F("% of "));
+	out.print(minutes());
+	out.println(F(" minutes"));
+
+	out.print(F("hours"));
+	for (uint8_t i = 0; i < DCFQualityHours; i++) {
+		uint8_t frames, minutes;
+		hour(i, frames, minutes);
+		out.print(' ');
+		out.print(frames);
+		out.print('/');
+		out.print(minutes);
+	}
+	out.println();
+
+	out.print(F("widths"));
+	for (uint8_t i = 0; i < DCFQualityBins; i++) {
+		out.print(' ');
+		out.print(histogram(i));
+	}
+	out.println();
+
+	for (uint8_t i = 0; i < QualityCauses; i++) {
+		if (i) out.print(' ');
+		out.print((const __FlashStringHelper *)pgm_read_ptr(&names[i]));
+		out.print(' ');
+		out.print(rejections(i));
+	}
+	out.println();
+}
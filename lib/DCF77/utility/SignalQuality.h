@@ -0,0 +1,100 @@
+#ifndef SignalQuality_h
+#define SignalQuality_h
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/*
+  Reception statistics in fixed memory, to judge antenna and conditions
+  rather than single frames.
+
+  - Pulse widths: a histogram of DCFQualityBins bins of DCFQualityBinMs,
+    the last bin takes everything longer. Rejected pulses count too, so
+    spikes show up in the first bins.
+  - Rejection causes: one counter per QualityCause, the pulse causes
+    from the interrupt handler, the frame causes from it and from the
+    checks in the main loop.
+  - Frames per hour: minute ends seen and frames accepted in each of the
+    last DCFQualityHours hours of millis(). millis() stands still while
+    the sketch is powered down, so these are hours the MCU ran.
+  - Score 0..100: a moving average over frames (accepted 100, lost 0)
+    weighted 3:1 against one over pulses (classified 100, rejected 0).
+
+  Histogram and causes halve together when one of them would overflow,
+  so their ratios hold and recent data weighs more. Updates come from the
+  interrupt handler and the main loop; every query is O(1).
+*/
+
+#define DCFQualityBins      16   // Pulse width histogram bins
+#define DCFQualityBinMs     20   // Width of one bin
+#define DCFQualityHours     24   // Hours of frame counts kept
+#define DCFQualityFrameAvg  3    // Moving average over 2^3 frames
+#define DCFQualityPulseAvg  6    // Moving average over 2^6 pulses
+
+enum QualityCause {
+	QualityMinGap,       // rCT: pulse too soon after the previous one
+	QualityWidth,        // rPW: width outside of the learned pulses
+	QualityStray,        // rSS/rDP: pulse in the silent second or in a second that has its bit
+	QualityPulseCauses,  // the causes above are pulses, the ones below frames
+	QualityOverflow = QualityPulseCauses, // EoB: more bits than a frame has
+	QualityShort,        // EoM: minute marker before the frame was complete
+	QualityHoles,        // BH: more than one bit missing
+	QualityQueueFull,    // QF: the main loop did not collect the frames in time
+	QualityParity,       // parity, zone bits or BCD ranges wrong
+	QualityNotLocked,    // DCF_ACCUMULATOR: frame added, no lock yet
+	QualityBounds,       // time outside of MIN_TIME..MAX_TIME
+	QualityLag,          // lag against the internal clock inconsistent
+	QualityCauses
+};
+
+class SignalQuality {
+public:
+	SignalQuality();
+	void reset(void);
+	// Continue the moving averages from averages() of an earlier run
+	void restore(uint8_t frames, uint8_t pulses);
+	// Width of a measured pulse, rejected or not
+	void width(uint16_t widthMs);
+	// A pulse became a bit
+	void pulse(void);
+	// A pulse or frame was thrown away
+	void reject(uint8_t cause);
+	// The decoder reached the end of a minute, complete frame or not
+	void minuteEnd(void);
+	// A frame passed all checks
+	void accepted(void);
+
+	uint16_t histogram(uint8_t bin);
+	uint16_t rejections(uint8_t cause);
+	// Frames accepted and minute ends seen hoursAgo hours back, 0 = this hour
+	void hour(uint8_t hoursAgo, uint8_t &frames, uint8_t &minutes);
+	// Accepted frames per minute end over the kept hours, percent
+	uint8_t rate(void);
+	uint16_t minutes(void);
+	uint8_t score(void);
+	// The frame and pulse moving averages behind score(), percent
+	void averages(uint8_t &frames, uint8_t &pulses);
+	// One line each: score and rate, hours (newest first), widths, causes
+	void report(Print &out);
+
+private:
+	// Shared with the interrupt handler; the main loop updates and reads
+	// them with interrupts off
+	uint16_t widths[DCFQualityBins];
+	uint16_t causes[QualityCauses];
+	uint8_t  hourFrames[DCFQualityHours];
+	uint8_t  hourMinutes[DCFQualityHours];
+	uint16_t sumFrames;           // over all kept hours
+	uint16_t sumMinutes;
+	uint8_t  slot;                // hour of millis() being counted
+	uint32_t slotStart;           // millis() at its start
+	uint16_t frameAvg;            // moving averages, percent << 8
+	uint16_t pulseAvg;
+
+	void roll(void);
+};
+
+#endif
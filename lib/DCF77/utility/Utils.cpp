@@ -1,48 +1,145 @@
 #include "Utils.h"
 
 namespace Utils {
-	
+
 // #define DEBUG_BLINK_PIN 8	 // Connected to debug led
 // #define DCF_VERBOSE_DEBUG 1	     // Verbose
 
-	void LogLn(char*s)
+#ifdef DCF_VERBOSE_DEBUG
+	struct LogEntry {
+		const char *text;    // NULL for a number
+		int         value;
+		uint8_t     format;  // DEC, HEX, ... for a number
+		bool        newline;
+		uint32_t    ms;
+	};
+
+	static LogEntry logQueue[DCFLogQueueSize];
+	static volatile uint8_t logHead = 0;
+	static volatile uint8_t logTail = 0;
+	static uint16_t logDropped = 0;
+	static uint16_t logReported = 0;  // drops already printed
+	static bool     lineOpen = false;
+
+	/**
+	 * Queue one entry. Interrupts are held off for the few stores, so the
+	 * main loop and the interrupt handler can both log
+	 */
+	static void enqueue(const char *text, int value, uint8_t format, bool newline)
+	{
+		uint32_t ms = millis();
+		uint8_t sreg = intDisable();
+		uint8_t next = (logHead + 1) & (DCFLogQueueSize - 1);
+		if (next == logTail) {
+			if (logDropped != 0xFFFF) logDropped++;
+		} else {
+			LogEntry &e = logQueue[logHead];
+			e.text    = text;
+			e.value   = value;
+			e.format  = format;
+			e.newline = newline;
+			e.ms      = ms;
+			logHead = next;
+		}
+		intRestore(sreg);
+	}
+
+	/**
+	 * Upper bound of the characters print() needs for an entry
+	 */
+	static uint8_t entryLength(const LogEntry &e)
+	{
+		uint8_t n = e.text ? strlen(e.text) : 33;  // int as 32 bit binary, sign
+		if (!lineOpen) n += 11;
+		if (e.newline) n += 2;
+		return n;
+	}
+
+	void LogFlush(void)
+	{
+		uint16_t dropped = LogDropped();
+		if (dropped != logReported && Serial.availableForWrite() >= 32) {
+			if (lineOpen) Serial.println();
+			Serial.print(F("log dropped "));
+			Serial.println(dropped - logReported);
+			logReported = dropped;
+			lineOpen = false;
+		}
+		while (logTail != logHead) {
+			// Copy first: the slot is free again once the tail moves on
+			LogEntry e = logQueue[logTail];
+			if (Serial.availableForWrite() < entryLength(e)) break;
+			logTail = (logTail + 1) & (DCFLogQueueSize - 1);
+			if (!lineOpen) {
+				Serial.print(e.ms);
+				Serial.print(' ');
+			}
+			if (e.text) {
+				Serial.print(e.text);
+			} else {
+				Serial.print(e.value, e.format);
+			}
+			if (e.newline) Serial.println();
+			lineOpen = !e.newline;
+		}
+	}
+
+	uint16_t LogDropped(void)
+	{
+		uint8_t sreg = intDisable();
+		uint16_t n = logDropped;
+		intRestore(sreg);
+		return n;
+	}
+#else
+	void LogFlush(void)
+	{
+	}
+
+	uint16_t LogDropped(void)
+	{
+		return 0;
+	}
+#endif
+
+	void LogLn(const char*s)
 	{
 	#ifdef DCF_VERBOSE_DEBUG
-		Serial.println(s);
+		enqueue(s, 0, 0, true);
 	#endif
 	}
 
-	void Log(char*s)
+	void Log(const char*s)
 	{
 	#ifdef DCF_VERBOSE_DEBUG
-	  Serial.print(s);
+		enqueue(s, 0, 0, false);
 	#endif
 	}
 	void Log(int i,char format)
 	{
 	#ifdef DCF_VERBOSE_DEBUG
-	  Serial.print(i, format);
+		enqueue(NULL, i, format, false);
 	#endif
 	}
 
 	void LogLn(int i,char format)
 	{
 	#ifdef DCF_VERBOSE_DEBUG
-	  Serial.println(i, format);
+		enqueue(NULL, i, format, true);
 	#endif
 	}
 
 	void Log(int i)
 	{
 	#ifdef DCF_VERBOSE_DEBUG
-	  Serial.print(i);
+		enqueue(NULL, i, DEC, false);
 	#endif
 	}
 
 	void LogLn(int i)
 	{
 	#ifdef DCF_VERBOSE_DEBUG
-	  Serial.println(i);
+		enqueue(NULL, i, DEC, true);
 	#endif
 	}
        
@@ -10,14 +10,31 @@
 
 #define intDisable()      ({ uint8_t sreg = SREG; cli(); sreg; })
 #define intRestore(sreg)  SREG = sreg 
+// Keep the compiler from moving memory accesses across this point
+#define compilerBarrier() __asm__ __volatile__("" ::: "memory")
+
+/*
+  With DCF_VERBOSE_DEBUG, Log() and LogLn() do not print: they queue the
+  text pointer or number with millis() in a ring of DCFLogQueueSize
+  entries, in constant time, so they can be called from the interrupt
+  handler without waiting on Serial. LogFlush(), from the main loop,
+  prints the queued entries, each line prefixed with the millis() of its
+  first entry, and only as far as the TX buffer of Serial has room.
+  Entries that find the ring full are dropped, counted by LogDropped()
+  and reported in the output. Texts must be string literals or otherwise
+  outlive the queue.
+*/
+#define DCFLogQueueSize   16   // entries, power of two
 
 namespace Utils {	
-	void Log(char*s);
-	void LogLn(char*s);
+	void Log(const char*s);
+	void LogLn(const char*s);
 	void Log(int i,char format);
 	void LogLn(int i,char format);
 	void Log(int i);
 	void LogLn(int i);
+	void LogFlush(void);
+	uint16_t LogDropped(void);
 	void BlinkDebug(uint8_t state);
 }
 
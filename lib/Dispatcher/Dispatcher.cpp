@@ -0,0 +1,76 @@
+#include "Dispatcher.h"
+#include <avr/sleep.h>
+
+Dispatcher::Dispatcher() : _count(0), _pending(0) {}
+
+byte Dispatcher::every(uint16_t periodMs, Handler handler)
+{
+  if (_count == DispatcherMaxTasks) return DispatcherMaxTasks;
+  Task &t = _tasks[_count];
+  t.handler = handler;
+  t.periodMs = periodMs;
+  t.next = millis();
+  return _count++;
+}
+
+byte Dispatcher::on(Handler handler)
+{
+  return every(0, handler);
+}
+
+void Dispatcher::signal(byte task)
+{
+  if (task >= DispatcherMaxTasks) return;
+  uint8_t sreg = SREG;
+  cli();
+  _pending |= 1U << task;
+  SREG = sreg;
+}
+
+bool Dispatcher::dispatch()
+{
+  // Taken before the handlers run: a signal raised meanwhile runs the
+  // task again on the next pass
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t pending = _pending;
+  _pending = 0;
+  SREG = sreg;
+
+  bool ran = false;
+  for (byte i = 0; i < _count; i++) {
+    Task &t = _tasks[i];
+    uint32_t now = millis();
+    bool periodic = t.periodMs && (int32_t)(now - t.next) >= 0;
+    if (!periodic && !(pending & (1U << i))) continue;
+    if (t.periodMs) t.next = now + t.periodMs;
+    t.handler();
+    ran = true;
+  }
+  return ran;
+}
+
+bool Dispatcher::due(uint32_t now)
+{
+  if (_pending) return true;
+  for (byte i = 0; i < _count; i++) {
+    if (_tasks[i].periodMs && (int32_t)(now - _tasks[i].next) >= 0) return true;
+  }
+  return false;
+}
+
+void Dispatcher::idle()
+{
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  if (due(millis())) {
+    sei();
+    return;
+  }
+  sleep_enable();
+  // The instruction after sei always runs before a pending interrupt, so
+  // a signal() that came in after the check still wakes the sleep
+  sei();
+  sleep_cpu();
+  sleep_disable();
+}
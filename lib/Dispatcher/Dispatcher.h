@@ -0,0 +1,64 @@
+#ifndef DISPATCHER_h
+#define DISPATCHER_h
+
+#include <Arduino.h>
+
+/*
+  Runs the main loop work as tasks instead of polling everything on every
+  pass.
+
+  A periodic task runs every periodMs of millis(). An event task runs once
+  after signal(), which interrupt handlers call to hand work to the main
+  loop; a periodic task can be signalled too, to run it ahead of time.
+
+    Dispatcher tasks;
+    byte light = tasks.every(500, readLight);
+    byte frame = tasks.on(frameReady);
+    ...
+    void loop() { tasks.dispatch(); tasks.idle(); }
+
+  dispatch() runs whatever is due, each task at most once, in the order
+  the tasks were added. Handlers always run in the main loop.
+
+  idle() puts the MCU into idle sleep until the next interrupt unless a
+  task is already due. The millis() interrupt of Timer0 wakes it at least
+  every 1024 us, so periodic tasks start at most that late; the external
+  interrupts (DCF77, PIR) and the serial receiver wake it immediately.
+*/
+
+#define DispatcherMaxTasks 16   // one pending bit each
+
+class Dispatcher
+{
+public:
+  typedef void (*Handler)(void);
+
+  Dispatcher();
+
+  // Add a task, returns its id for signal()
+  byte every(uint16_t periodMs, Handler handler);
+  byte on(Handler handler);
+
+  // Run the task on the next dispatch(); safe in interrupt handlers
+  void signal(byte task);
+
+  // Run the due tasks, whether any ran
+  bool dispatch();
+  // Sleep until the next interrupt when nothing is due
+  void idle();
+
+private:
+  struct Task {
+    Handler  handler;
+    uint16_t periodMs;    // 0 for event tasks
+    uint32_t next;
+  };
+
+  bool due(uint32_t now);
+
+  Task _tasks[DispatcherMaxTasks];
+  byte _count;
+  volatile uint16_t _pending;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "fidelio_animator.h"
+
+FidelioAnimator::FidelioAnimator(FidelioDisplay &display) : _display(display) {
+  _effect = NONE;
+  _text = 0;
+  _pages = 0;
+  _fading = false;
+}
+
+void FidelioAnimator::scroll(const char *text, uint16_t stepMs)
+{
+  stop();
+  _effect = SCROLL;
+  _text = text;
+  _textLen = strlen(text);
+  _textPos = -3;            // First character enters at the right
+  _step = stepMs;
+  _next = millis();
+}
+
+void FidelioAnimator::blink(byte digits, uint16_t periodMs, byte times)
+{
+  stop();
+  _effect = BLINK;
+  _blinkDigits = digits;
+  _blinks = times;
+  _blinkOff = false;
+  _step = periodMs / 2;
+  _next = millis();
+}
+
+void FidelioAnimator::rotate(const Page *pages, byte count, uint16_t holdMs, bool repeat)
+{
+  stop();
+  if (count == 0) return;
+  _effect = ROTATE;
+  _pages = pages;
+  _count = count;
+  _page = 0;
+  _repeat = repeat;
+  _step = holdMs;
+  _next = millis();
+}
+
+void FidelioAnimator::stop()
+{
+  if (_effect == BLINK) _display.hide(0);
+  _effect = NONE;
+}
+
+bool FidelioAnimator::busy()
+{
+  return _effect != NONE;
+}
+
+void FidelioAnimator::fade(byte from, byte to, uint16_t stepMs)
+{
+  _bright = from & 7;
+  _target = to & 7;
+  _fadeStep = stepMs;
+  _fading = _bright != _target;
+  _display.setBright(_bright);
+  _fadeNext = millis() + stepMs;
+}
+
+bool FidelioAnimator::fading()
+{
+  return _fading;
+}
+
+// Whether a step is due; schedules the next one without drift, or from
+// now when this step was so late that the next would follow in less than
+// half a step
+bool FidelioAnimator::due(uint32_t now, uint32_t &next, uint16_t step)
+{
+  if ((int32_t)(now - next) < 0) return false;
+  next += step;
+  if ((int32_t)(next - now) < (int32_t)(step / 2)) next = now + step;
+  return true;
+}
+
+void FidelioAnimator::tick(uint32_t now)
+{
+  if (_effect != NONE && due(now, _next, _step)) {
+    switch (_effect) {
+      case SCROLL: stepScroll(); break;
+      case BLINK:  stepBlink();  break;
+      case ROTATE: stepRotate(); break;
+    }
+  }
+  if (_fading && due(now, _fadeNext, _fadeStep)) {
+    _bright += _bright < _target ? 1 : -1;
+    _display.setBright(_bright);
+    if (_bright == _target) _fading = false;
+  }
+}
+
+void FidelioAnimator::stepScroll()
+{
+  if (_textPos > _textLen) {
+    // The last character has left on the previous step
+    _effect = NONE;
+    return;
+  }
+  FidelioDisplay::Glyphs glyphs;
+  for (int i = 0; i < 4; i++) {
+    int at = _textPos + i;
+    glyphs.digit[i] = at >= 0 && at < _textLen ? FidelioDisplay::glyph(_text[at]) : 0;
+  }
+  _display.print(glyphs);
+  _textPos++;
+}
+
+void FidelioAnimator::stepBlink()
+{
+  _blinkOff = !_blinkOff;
+  _display.hide(_blinkOff ? _blinkDigits : 0);
+  if (!_blinkOff && _blinks && --_blinks == 0) _effect = NONE;
+}
+
+void FidelioAnimator::stepRotate()
+{
+  if (_page == _count) {
+    if (!_repeat) {
+      _effect = NONE;
+      return;
+    }
+    _page = 0;
+  }
+  _pages[_page++](_display);
+}
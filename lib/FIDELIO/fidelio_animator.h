@@ -0,0 +1,74 @@
+#ifndef FIDELIOANIMATOR_h
+#define FIDELIOANIMATOR_h
+
+#include <Arduino.h>
+#include "fidelio_display.h"
+
+/*
+  Cooperative effects for the Fidelio display: scrolling text, blinking
+  digits, a rotation of pages (date, year, ...) and brightness fades.
+
+  Nothing here waits. Effects are driven by millis() timestamps and
+  advanced by tick(), which loop() calls every iteration: each call does at
+  most one step of the content effect and one of the fade, so its cost is
+  bounded by one display flush and one brightness command. Steps keep to
+  their schedule; a step late by more than half its interval restarts the
+  schedule from the current time instead of bunching up with the next.
+
+  The content effects (scroll, blink, rotate) share the digits, starting
+  one replaces the running one. A fade runs alongside them.
+*/
+
+class FidelioAnimator
+{
+public:
+  // Draws one page of a rotation
+  typedef void (*Page)(FidelioDisplay &display);
+
+  FidelioAnimator(FidelioDisplay &display);
+
+  // Move text from right to left through the display, one character per
+  // stepMs. The text is not copied and must stay valid while scrolling.
+  void scroll(const char *text, uint16_t stepMs = 300);
+  // Blink the digits in the mask (bit 0 = leftmost) over what is shown,
+  // times blinks or until stop() when times is 0
+  void blink(byte digits, uint16_t periodMs = 500, byte times = 0);
+  // Show count pages for holdMs each, once or over and over
+  void rotate(const Page *pages, byte count, uint16_t holdMs, bool repeat = false);
+  void stop();
+  bool busy();
+
+  // Step the brightness from one level (0..7) to another
+  void fade(byte from, byte to, uint16_t stepMs = 60);
+  bool fading();
+
+  void tick(uint32_t now);
+
+private:
+  enum Effect { NONE, SCROLL, BLINK, ROTATE };
+
+  bool due(uint32_t now, uint32_t &next, uint16_t step);
+  void stepScroll();
+  void stepBlink();
+  void stepRotate();
+
+  FidelioDisplay &_display;
+
+  byte _effect;
+  uint32_t _next;
+  uint16_t _step;
+  const char *_text;
+  int _textPos, _textLen;
+  const Page *_pages;
+  byte _count, _page;
+  bool _repeat;
+  byte _blinkDigits, _blinks;
+  bool _blinkOff;
+
+  bool _fading;
+  byte _bright, _target;
+  uint32_t _fadeNext;
+  uint16_t _fadeStep;
+};
+
+#endif
@@ -1,7 +1,7 @@
 #include "fidelio_display.h"
 #include <SPI.h>
+#include <CpuProfile.h>
 
-word FidelioDisplay::numbers[] = {0x3F00, 0x0600, 0x5B00, 0x4F00, 0x6600, 0x6D00, 0x7D00, 0x0700, 0x7F00, 0x6F00, 0x0000}; //0..9: where : = empty
 byte FidelioDisplay::daddr[]   = {0xC6, 0xC4, 0xC2, 0xC0};
 
 // namespace PT6964 {
@@ -14,6 +14,11 @@ FidelioDisplay::FidelioDisplay(int dioPin, int clkPin, int stbPin, uint32_t spiC
   _dots = false;
   _pm = false;
   _alarm = false;
+  memset(_digits, 0, sizeof(_digits));
+  memset(_shown, 0, sizeof(_shown));
+  _hidden = 0;
+  _synced = false;
+  _mode = _control = 0xFF;
   displaySPI = new SPIClass();
 }
 
@@ -25,13 +30,16 @@ void FidelioDisplay::init()
  #ifdef ESP32
   displaySPI->begin(_clkPin, -1, _dioPin, _stbPin);
   pinMode(displaySPI->pinSS(), OUTPUT);  
- #elif defined(AVR328)
+ #elif defined(AVR328) || defined(NATIVE)
   displaySPI->begin();
   pinMode(_stbPin, OUTPUT);
 #endif
 
   delay(250);
-  sendCommand(CMD_MODE_WRITE_INCREMENT);  // Default write increment addr
+  // Nothing is known about the controller's state yet
+  _synced = false;
+  _mode = _control = 0xFF;
+  setMode(CMD_MODE_WRITE_INCREMENT);      // Default write increment addr
   sendCommand(CMD_DISPLAY_4x13);          // Configure as 4Dig 13Seg
   cls();
   setBright(7);
@@ -39,28 +47,30 @@ void FidelioDisplay::init()
 
 void FidelioDisplay::setBright(int level)
 {
-  sendCommand(CMD_DISPLAY_ON | (level & CMD_DISPLAY_ON_MASK) );
+  byte control = CMD_DISPLAY_ON | (level & CMD_DISPLAY_ON_MASK);
+  if (control == _control) return;
+  _control = control;
+  sendCommand(control);
 }
 
 void FidelioDisplay::Off()
 {
+  if (_control == CMD_DISPLAY_OFF) return;
+  _control = CMD_DISPLAY_OFF;
   sendCommand(CMD_DISPLAY_OFF);
 }
 
 void FidelioDisplay::On()
 {
-  sendCommand(CMD_DISPLAY_ON);
+  setBright(0);
 }
 
+// Blank all digits, dots and indicators
 void FidelioDisplay::cls()
 {
-  sendCommand(CMD_MODE_WRITE_INCREMENT);
-  spiStart();
-  sendByte(CMD_SET_ADDR_0);    // 3: Set address to 00 / first
-  for(int i = 0; i < 4; i++) { // clear display memory (4 digits)
-    sendWord(0x0000);
-  }
-  spiStop();
+  memset(_digits, 0, sizeof(_digits));
+  _dots = _pm = _alarm = false;
+  flush();
 }
 
 
@@ -96,46 +106,142 @@ void FidelioDisplay::cls()
 
 void FidelioDisplay::write(char *buf)
 {
-  sendCommand(CMD_MODE_WRITE_FIXED_ADDRESS);
+  PROFILE_SCOPE(PROFILE_DISPLAY_WRITE);
   for (int i = 0; i < 4; i++)  {
-    // Serial.println(buf[i]);
     if (buf[i] == 0) break;
-    word data = numbers[buf[i] - '0'] + daddr[i];
-    if (_dots  && i == 1) data |= 0x8000;
-    if (_alarm && i == 2) data |= 0x8000;
-    if (_pm    && i == 3) data |= 0x8000;
-    spiStart();
-    sendWord(data);
-    spiStop();
+    _digits[i] = glyph(buf[i]);
   }
+  flush();
 }
 
-void FidelioDisplay::at(byte pos, char digit)
+void FidelioDisplay::at(byte pos, char c)
 {
-  if (pos > 4) return;
-  sendCommand(CMD_MODE_WRITE_FIXED_ADDRESS);
-  // sendByte(daddr[pos]);    // 3: Set address to 00 / first  
-  word data = numbers[digit - '0'] + daddr[pos];
-  if (_dots  && pos == 1) data |= 0x8000;
-  if (_alarm && pos == 2) data |= 0x8000;
-  if (_pm    && pos == 3) data |= 0x8000;
-  spiStart();
-  sendWord(data);
-  spiStop();
+  if (pos > 3) return;
+  _digits[pos] = glyph(c);
+  flush();
 }
 
 void FidelioDisplay::draw(byte pos, byte what)
 {
-  if (pos > 4) return;
-  sendCommand(CMD_MODE_WRITE_FIXED_ADDRESS);
-  // sendByte(daddr[pos]);    // 3: Set address to 00 / first  
-  word data = (what << 8) + daddr[pos];
-  if (_dots  && pos == 1) data |= 0x8000;
-  if (_alarm && pos == 2) data |= 0x8000;
-  if (_pm    && pos == 3) data |= 0x8000;
-  spiStart();
-  sendWord(data);
-  spiStop();
+  if (pos > 3) return;
+  _digits[pos] = what;
+  flush();
+}
+
+void FidelioDisplay::print(Glyphs glyphs)
+{
+  memcpy(_digits, glyphs.digit, sizeof(_digits));
+  flush();
+}
+
+void FidelioDisplay::print(const char *text)
+{
+  PROFILE_SCOPE(PROFILE_DISPLAY_WRITE);
+  for (byte i = 0; i < 4; i++) {
+    _digits[i] = *text ? glyph(*text++) : 0;
+  }
+  flush();
+}
+
+void FidelioDisplay::print(long value, byte base)
+{
+  PROFILE_SCOPE(PROFILE_DISPLAY_WRITE);
+  setNumber(0, 4, value, base, ' ');
+  flush();
+}
+
+void FidelioDisplay::printAt(byte pos, byte width, long value, byte base, char pad)
+{
+  if (pos > 3 || width == 0) return;
+  if (width > 4 - pos) width = 4 - pos;
+  setNumber(pos, width, value, base, pad);
+  flush();
+}
+
+void FidelioDisplay::printTime(byte hour, byte minute)
+{
+  PROFILE_SCOPE(PROFILE_DISPLAY_WRITE);
+  setNumber(0, 2, hour, DEC, '0');
+  setNumber(2, 2, minute, DEC, '0');
+  flush();
+}
+
+// Digits of value straight into the framebuffer, right to left
+void FidelioDisplay::setNumber(byte pos, byte width, long value, byte base, char pad)
+{
+  if (base < 2 || base > 16) base = DEC;
+  unsigned long rest = value < 0 ? 0UL - (unsigned long)value : value;
+  byte i = pos + width;
+  do {
+    byte d = rest % base;
+    _digits[--i] = glyph(d < 10 ? '0' + d : 'A' - 10 + d);
+    rest /= base;
+  } while (rest && i > pos);
+  if (value < 0 && i > pos) {
+    _digits[--i] = glyph('-');
+  } else if (value < 0) {
+    rest = 1;
+  }
+  if (rest) {
+    // Does not fit
+    for (i = pos; i < pos + width; i++) _digits[i] = glyph('-');
+    return;
+  }
+  while (i > pos) _digits[--i] = glyph(pad);
+}
+
+void FidelioDisplay::hide(byte digits)
+{
+  _hidden = digits & 0x0F;
+  flush();
+}
+
+// Segments of a digit including the flag shown with it
+byte FidelioDisplay::compose(byte pos)
+{
+  if (_hidden & (1 << pos)) return 0;
+  byte data = _digits[pos];
+  if (_dots  && pos == 1) data |= 0x80;
+  if (_alarm && pos == 2) data |= 0x80;
+  if (_pm    && pos == 3) data |= 0x80;
+  return data;
+}
+
+// Send the digits that differ from what the display holds: a few of them
+// one by one at fixed addresses, most of them as a single burst
+void FidelioDisplay::flush()
+{
+  byte changed = 0, count = 0;
+  for (byte i = 0; i < 4; i++) {
+    if (!_synced || compose(i) != _shown[i]) {
+      changed |= 1 << i;
+      count++;
+    }
+  }
+  if (count == 0) return;
+
+  if (count >= 3) {
+    // Display memory from address 0 holds the digits right to left, each
+    // followed by a byte of segments this display does not have
+    setMode(CMD_MODE_WRITE_INCREMENT);
+    spiStart();
+    sendByte(CMD_SET_ADDR_0);
+    for (int8_t i = 3; i >= 0; i--) {
+      _shown[i] = compose(i);
+      sendWord(_shown[i]);
+    }
+    spiStop();
+  } else {
+    setMode(CMD_MODE_WRITE_FIXED_ADDRESS);
+    for (byte i = 0; i < 4; i++) {
+      if (!(changed & (1 << i))) continue;
+      _shown[i] = compose(i);
+      spiStart();
+      sendWord(((word)_shown[i] << 8) | daddr[i]);
+      spiStop();
+    }
+  }
+  _synced = true;
 }
 
 void FidelioDisplay::sendByte(byte data) {
@@ -156,7 +262,14 @@ void FidelioDisplay::spiStop() {
   displaySPI->endTransaction();
 }
 
+void FidelioDisplay::setMode(byte mode) {
+  if (mode == _mode) return;
+  _mode = mode;
+  sendCommand(mode);
+}
+
 void FidelioDisplay::sendCommand(byte data) {
+  PROFILE_SCOPE(PROFILE_DISPLAY_COMMAND);
   spiStart();
   sendByte(data);
   spiStop();
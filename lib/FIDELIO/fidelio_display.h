@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include "fidelio_font.h"
 
 /*
   1 -- 
@@ -31,12 +32,47 @@ Pinout at fidelio-display
 class FidelioDisplay
 {
 public:
+  // Segments of the four digits, see text()
+  struct Glyphs {
+    byte digit[4];
+  };
+
+  // Glyphs of a text of up to four characters. Initialize a constexpr
+  // Glyphs with it and the font lookup happens at compile time:
+  //   constexpr FidelioDisplay::Glyphs syncText = FidelioDisplay::text("SYnC");
+  // It is for constant expressions only; at run time use print(const char *).
+  template <size_t N>
+  static constexpr Glyphs text(const char (&s)[N])
+  {
+    return Glyphs{{ glyphOf(s, N, 0), glyphOf(s, N, 1), glyphOf(s, N, 2), glyphOf(s, N, 3) }};
+  }
+
   FidelioDisplay(int dioPin, int clkPin, int stbPin, uint32_t spiClk);
   void init();
   void cls();
   void write(char *buf);
-  void at(byte pos, char digit);
+  void at(byte pos, char c);
   void draw(byte pos, byte what);
+  void print(Glyphs glyphs);
+  // Left aligned, blank padded to four digits
+  void print(const char *text);
+  // Right aligned in all four digits, '-' for negative values
+  void print(int value, byte base = DEC) { print((long)value, base); }
+  void print(long value, byte base = DEC);
+  // Right aligned in width digits from pos, filled with pad on the left.
+  // Values that do not fit show as dashes.
+  void printAt(byte pos, byte width, long value, byte base = DEC, char pad = ' ');
+  // HHMM with leading zeros, the colon is dots()
+  void printTime(byte hour, byte minute);
+  // Blank the digits in the mask (bit 0 = leftmost) without losing them
+  void hide(byte digits);
+  void flush();
+
+  // Segments of a character, read from the font in flash
+  static byte glyph(char c)
+  {
+    return pgm_read_byte(&fidelioFont[c & 0x7F]);
+  }
   void Off();
   void On();
   void setBright(int level);
@@ -65,12 +101,32 @@ private:
   void spiStart();
   void spiStop();
   void sendCommand(byte data);
+  void setMode(byte mode);
+  byte compose(byte pos);
+  void setNumber(byte pos, byte width, long value, byte base, char pad);
+
+  // The font for text(). It has no out-of-line definition, so it takes
+  // no memory, and with the C++11 of the AVR toolchain a text() that is
+  // not evaluated at compile time fails to link instead of copying it
+  static constexpr byte constFont[128] = FIDELIO_FONT;
+
+  static constexpr byte glyphOf(const char *s, size_t n, size_t i)
+  {
+    return i + 1 < n ? constFont[s[i] & 0x7F] : 0;
+  }
 
   int _dioPin, _clkPin, _stbPin;
   uint32_t _spiClk;
   bool _pm, _alarm, _dots;
+  // Shadow of the display memory: segments per digit as set by the caller,
+  // and what the display holds (segments with the flag bit) after the last
+  // flush. The last mode and display control commands are cached as well.
+  byte _digits[4];
+  byte _shown[4];
+  byte _hidden;
+  bool _synced;
+  byte _mode, _control;
   long _tLastTime;
-  static word numbers[];
   static byte daddr[];
 
 };
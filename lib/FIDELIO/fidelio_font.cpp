@@ -0,0 +1,3 @@
+#include "fidelio_font.h"
+
+const byte fidelioFont[128] PROGMEM = FIDELIO_FONT;
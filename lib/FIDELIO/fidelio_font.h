@@ -0,0 +1,40 @@
+#ifndef FIDELIOFONT_h
+#define FIDELIOFONT_h
+
+#include <Arduino.h>
+
+/*
+  Seven segment glyphs for 7-bit ASCII, bit layout as in fidelio_display.h
+  (a = 1 ... g = 64). Letters use the usual mixed-case shapes, so "SYnC",
+  "Err" and "rtc" read as intended; characters without a sensible shape
+  (control codes, ':' and '.', which this display has as separate
+  indicators, and a few symbols) are blank. '*' is the degree sign.
+
+  FIDELIO_FONT is the table as an initializer. fidelioFont, defined once
+  in fidelio_font.cpp, holds it in flash for run time lookups, which have
+  to go through pgm_read_byte(); FidelioDisplay::text() keeps a constexpr
+  copy for lookups at compile time.
+*/
+
+#define FIDELIO_FONT { \
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* control           */ \
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* control           */ \
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* control           */ \
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  /* control           */ \
+  0x00, 0x00, 0x22, 0x00, 0x00, 0x00, 0x00, 0x20,  /* sp ! " # $ % & '  */ \
+  0x39, 0x0F, 0x63, 0x00, 0x00, 0x40, 0x00, 0x52,  /* ( ) * + , - . /   */ \
+  0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,  /* 0 1 2 3 4 5 6 7   */ \
+  0x7F, 0x6F, 0x00, 0x00, 0x58, 0x48, 0x4C, 0x53,  /* 8 9 : ; < = > ?   */ \
+  0x00, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71, 0x3D,  /* @ A B C D E F G   */ \
+  0x76, 0x30, 0x1E, 0x75, 0x38, 0x37, 0x37, 0x3F,  /* H I J K L M N O   */ \
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x3E, 0x3E, 0x7E,  /* P Q R S T U V W   */ \
+  0x76, 0x6E, 0x5B, 0x39, 0x64, 0x0F, 0x23, 0x08,  /* X Y Z [ \ ] ^ _   */ \
+  0x02, 0x5F, 0x7C, 0x58, 0x5E, 0x7B, 0x71, 0x6F,  /* ` a b c d e f g   */ \
+  0x74, 0x10, 0x0E, 0x75, 0x30, 0x54, 0x54, 0x5C,  /* h i j k l m n o   */ \
+  0x73, 0x67, 0x50, 0x6D, 0x78, 0x1C, 0x1C, 0x1C,  /* p q r s t u v w   */ \
+  0x76, 0x6E, 0x5B, 0x39, 0x30, 0x0F, 0x01, 0x00,  /* x y z { | } ~     */ \
+}
+
+extern const byte fidelioFont[128] PROGMEM;
+
+#endif
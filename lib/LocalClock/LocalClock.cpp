@@ -0,0 +1,144 @@
+#include "LocalClock.h"
+
+static const uint8_t monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+static bool leapYear(uint16_t y)
+{
+  return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+LocalClock::LocalClock(const TimeChangeRule &dstStart, const TimeChangeRule &stdStart)
+  : _dstStart(dstStart), _stdStart(stdStart), _minuteUtc(0), _nextChange(0),
+    _sentUntil(0), _changeAt(0)
+{
+}
+
+void LocalClock::update(time_t utc)
+{
+  time_t since = utc - _minuteUtc;
+  if (utc >= _minuteUtc && since < 60) {
+    _second = since;
+    return;
+  }
+  if (utc < _minuteUtc || since >= 120 || utc >= _nextChange || _nextChange == 0) {
+    convert(utc);
+    return;
+  }
+  // The next minute
+  _minuteUtc += 60;
+  _second = since - 60;
+  if (++_minute < 60) return;
+  _minute = 0;
+  if (++_hour < 24) return;
+  _hour = 0;
+  _weekday = _weekday % 7 + 1;
+  uint8_t days = monthDays[_month - 1] + (_month == 2 && leapYear(_year));
+  if (++_day <= days) return;
+  _day = 1;
+  if (++_month <= 12) return;
+  _month = 1;
+  _year++;
+}
+
+time_t LocalClock::local() const
+{
+  return _minuteUtc + _second + _offset * (long)SECS_PER_MIN;
+}
+
+long LocalClock::secondsToday() const
+{
+  return (_hour * 60L + _minute) * 60 + _second;
+}
+
+// The local time of the change in the given year, as Timezone::toTime_t
+time_t LocalClock::transition(const TimeChangeRule &r, int year) const
+{
+  uint8_t m = r.month;
+  uint8_t w = r.week;
+  if (w == 0) {
+    // Last week: the first of the next month, one week back
+    if (++m > 12) {
+      m = 1;
+      year++;
+    }
+    w = 1;
+  }
+  tmElements_t tm;
+  tm.Hour = r.hour;
+  tm.Minute = 0;
+  tm.Second = 0;
+  tm.Day = 1;
+  tm.Month = m;
+  tm.Year = year - 1970;
+  time_t t = makeTime(tm);
+  t += ((r.dow - ::weekday(t) + 7) % 7 + (w - 1) * 7) * SECS_PER_DAY;
+  if (r.week == 0) t -= 7 * SECS_PER_DAY;
+  return t;
+}
+
+// Offset and DST by the rules at utc, returns the UTC of the next change
+time_t LocalClock::rules(time_t utc, int &offset, bool &dst) const
+{
+  int y = ::year(utc);
+  // UTC of the changes this year and the next: DST starts in standard
+  // time, ends in summer time
+  time_t changes[4];
+  for (byte i = 0; i < 2; i++) {
+    changes[2 * i] = transition(_dstStart, y + i) - _stdStart.offset * SECS_PER_MIN;
+    changes[2 * i + 1] = transition(_stdStart, y + i) - _dstStart.offset * SECS_PER_MIN;
+  }
+  time_t dstUtc = changes[0], stdUtc = changes[1];
+  if (dstUtc < stdUtc) {
+    dst = utc >= dstUtc && utc < stdUtc;
+  } else {
+    // Southern hemisphere: summer time over the turn of the year
+    dst = !(utc >= stdUtc && utc < dstUtc);
+  }
+  offset = dst ? _dstStart.offset : _stdStart.offset;
+  time_t next = 0;
+  for (byte i = 0; i < 4; i++) {
+    if (changes[i] > utc && (next == 0 || changes[i] < next)) next = changes[i];
+  }
+  return next;
+}
+
+void LocalClock::transmitted(time_t utc, int offset, bool dst, time_t changeAt)
+{
+  int ruleOffset;
+  bool ruleDst;
+  _sentUntil = rules(utc, ruleOffset, ruleDst);
+  _sentOffset = offset;
+  _sentDst = dst;
+  _changeAt = changeAt > utc ? changeAt : 0;
+  // The offset after the announced change holds until the rules change next
+  if (_changeAt && _changeAt >= _sentUntil) _sentUntil = rules(_changeAt, ruleOffset, ruleDst);
+  convert(utc);
+}
+
+void LocalClock::convert(time_t utc)
+{
+  _nextChange = rules(utc, _offset, _dst);
+  if (utc < _sentUntil) {
+    _offset = _sentOffset;
+    _dst = _sentDst;
+    if (_changeAt && utc >= _changeAt) {
+      int shift = _dstStart.offset - _stdStart.offset;
+      _offset += _dst ? -shift : shift;
+      _dst = !_dst;
+    } else if (_changeAt && _changeAt < _nextChange) {
+      _nextChange = _changeAt;
+    }
+    if (_sentUntil < _nextChange) _nextChange = _sentUntil;
+  }
+
+  tmElements_t tm;
+  breakTime(utc + _offset * (long)SECS_PER_MIN, tm);
+  _second = tm.Second;
+  _minute = tm.Minute;
+  _hour = tm.Hour;
+  _day = tm.Day;
+  _month = tm.Month;
+  _year = tm.Year + 1970;
+  _weekday = tm.Wday;
+  _minuteUtc = utc - _second;
+}
@@ -0,0 +1,75 @@
+#ifndef LOCALCLOCK_h
+#define LOCALCLOCK_h
+
+#include <Arduino.h>
+#include <Time.h>
+#include <Timezone.h>
+
+/*
+  Local time kept up to date incrementally, for the display that asks
+  for it every second.
+
+  update() remembers the UTC start of the current local minute, the UTC
+  offset and the instant of the next DST change. Within the minute it only
+  subtracts; on the next minute it carries into the hour, day, month and
+  year fields. It converts from scratch (breakTime and the transition
+  times of the year, as Timezone::toLocal does) only when time jumps or a
+  DST change is reached.
+
+  transmitted() hands it the offset DCF77 sends with a frame, whether
+  that is summer time, and, when a change is announced, the hour it takes
+  effect. That offset wins over the rules until the next change the rules
+  know of; an announced change happens exactly at its hour, by the
+  difference of the rules' offsets, and the offset after it holds until
+  the rules' next change after it. The rules bridge the time between
+  frames.
+
+    LocalClock local(rCEST, rCET);
+    local.update(now());
+    display.printTime(local.hour(), local.minute());
+*/
+
+class LocalClock
+{
+public:
+  // The same rules as for Timezone
+  LocalClock(const TimeChangeRule &dstStart, const TimeChangeRule &stdStart);
+
+  void update(time_t utc);
+  // Offset (minutes) and summer time transmitted for utc; changeAt is the
+  // UTC of an announced change, 0 for none
+  void transmitted(time_t utc, int offset, bool dst, time_t changeAt);
+
+  uint8_t  second() const  { return _second; }
+  uint8_t  minute() const  { return _minute; }
+  uint8_t  hour() const    { return _hour; }
+  uint8_t  day() const     { return _day; }
+  uint8_t  month() const   { return _month; }
+  uint16_t year() const    { return _year; }
+  uint8_t  weekday() const { return _weekday; }   // 1 is Sunday, as in Time
+  bool     dst() const     { return _dst; }
+  time_t   local() const;
+  long     secondsToday() const;
+  // UTC of the next offset change, as of the last update()
+  time_t   nextChange() const { return _nextChange; }
+
+private:
+  void convert(time_t utc);
+  time_t rules(time_t utc, int &offset, bool &dst) const;
+  time_t transition(const TimeChangeRule &r, int year) const;
+
+  TimeChangeRule _dstStart, _stdStart;
+  time_t  _minuteUtc;     // UTC of second 0 of the local minute
+  time_t  _nextChange;    // UTC of the next DST change
+  int     _offset;        // minutes
+  bool    _dst;
+  // The last transmitted offset, valid until _sentUntil, and the announced change
+  int     _sentOffset;
+  bool    _sentDst;
+  time_t  _sentUntil;
+  time_t  _changeAt;
+  uint8_t _second, _minute, _hour, _day, _month, _weekday;
+  uint16_t _year;
+};
+
+#endif
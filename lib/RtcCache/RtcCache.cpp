@@ -0,0 +1,124 @@
+#include "RtcCache.h"
+#include <Wire.h>
+#include <CpuProfile.h>
+#include <avr/pgmspace.h>
+
+namespace RtcCache {
+
+  static const uint32_t secondsTo2000 = 946684800UL;
+  static const uint16_t daysTo2000 = 10957;
+  static const uint8_t monthDays[12] PROGMEM = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  static bool     cached;
+  static uint32_t cachedTime;
+  static uint32_t cachedMillis;
+
+  static uint8_t bcd(uint8_t v) { return v + 6 * (v / 10); }
+  static uint8_t bin(uint8_t v) { return v - 6 * (v >> 4); }
+
+  static bool readRegisters(uint8_t reg, uint8_t *buf, uint8_t len)
+  {
+    PROFILE_SCOPE(PROFILE_RTC_NOW);
+    Wire.beginTransmission(RtcCacheAddress);
+    Wire.write(reg);
+    if (Wire.endTransmission() != 0) return false;
+    if (Wire.requestFrom((uint8_t)RtcCacheAddress, len) != len) return false;
+    for (uint8_t i = 0; i < len; i++) buf[i] = Wire.read();
+    return true;
+  }
+
+  // The DS1307 counts the years 2000-2099, each fourth one a leap year;
+  // hours are always written in 24 hour mode
+  static uint32_t fromRegisters(const uint8_t *r)
+  {
+    uint8_t y = bin(r[6]);
+    uint8_t m = bin(r[5] & 0x1F);
+    if (m > 12) m = 12;
+    uint16_t days = y * 365U + (y + 3) / 4 + bin(r[4] & 0x3F) - 1;
+    for (uint8_t i = 1; i < m; i++) days += pgm_read_byte(&monthDays[i - 1]);
+    if (m > 2 && y % 4 == 0) days++;
+    return secondsTo2000 + ((days * 24UL + bin(r[2] & 0x3F)) * 60 + bin(r[1])) * 60 + bin(r[0] & 0x7F);
+  }
+
+  static void toRegisters(uint32_t t, uint8_t *r)
+  {
+    r[0] = bcd(t % 60);   // clock halt bit clear
+    t /= 60;
+    r[1] = bcd(t % 60);
+    t /= 60;
+    r[2] = bcd(t % 24);
+    uint16_t days = t / 24 - daysTo2000;
+    r[3] = (days + 6) % 7 + 1;   // 1 is Sunday, 2000-01-01 was a Saturday
+    uint8_t y = days / 1461 * 4;
+    days %= 1461;
+    if (days >= 366) {
+      days -= 366;
+      y += 1 + days / 365;
+      days %= 365;
+    }
+    uint8_t m = 0;
+    for (;; m++) {
+      uint8_t len = pgm_read_byte(&monthDays[m]) + (m == 1 && y % 4 == 0);
+      if (days < len) break;
+      days -= len;
+    }
+    r[4] = bcd(days + 1);
+    r[5] = bcd(m + 1);
+    r[6] = bcd(y);
+  }
+
+  bool running(void)
+  {
+    uint8_t ss;
+    return readRegisters(0, &ss, 1) && !(ss & 0x80);
+  }
+
+  time_t read(void)
+  {
+    uint8_t r[7];
+    if (!readRegisters(0, r, 7)) {
+      cached = false;
+      return 0;
+    }
+    cachedTime = fromRegisters(r);
+    cachedMillis = millis();
+    cached = true;
+    return cachedTime;
+  }
+
+  time_t readSeconds(void)
+  {
+    if (!cached || millis() - cachedMillis > RtcCacheMaxAgeMs) return read();
+    uint8_t ss;
+    if (!readRegisters(0, &ss, 1)) return 0;
+    uint32_t expected = cachedTime + (millis() - cachedMillis) / 1000;
+    int8_t d = bin(ss & 0x7F) - expected % 60;
+    if (d > 30) d -= 60;
+    else if (d < -30) d += 60;
+    return expected + d;
+  }
+
+  void write(time_t t)
+  {
+    uint8_t r[7];
+    toRegisters(t, r);
+    Wire.beginTransmission(RtcCacheAddress);
+    Wire.write((uint8_t)0);
+    for (uint8_t i = 0; i < 7; i++) Wire.write(r[i]);
+    if (Wire.endTransmission() != 0) {
+      cached = false;
+      return;
+    }
+    cachedTime = t;
+    cachedMillis = millis();
+    cached = true;
+  }
+
+  uint8_t nvramCheck(const void *data, uint8_t length, uint8_t seed)
+  {
+    const uint8_t *p = (const uint8_t *)data;
+    uint8_t c = seed;
+    for (uint8_t i = 0; i < length; i++) c = ((c << 1) | (c >> 7)) ^ p[i];
+    return c;
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef RTCCACHE_h
+#define RTCCACHE_h
+
+#include <Arduino.h>
+#include <Time.h>
+
+/*
+  Direct register access to the DS1307 over Wire, converting between
+  time_t and the BCD registers without DateTime or tmElements_t.
+
+  read() fetches all seven time registers and keeps the result with its
+  millis(). readSeconds() then puts only the seconds register on the bus,
+  4 bytes instead of 10, and takes the minute and above from that cache
+  extrapolated with millis(); after RtcCacheMaxAgeMs it falls back to a
+  full read. That is what polling for the second edge needs. write()
+  keeps the cache in step; set the time only through it, as a write
+  past it (RTC_DS1307::adjust()) would leave readSeconds() carrying on
+  the old registers. After millis() stood still, e.g. in power-down,
+  read() again (ClockDiscipline::resume() does).
+
+  Call Wire.begin() (RTC_DS1307::begin() does) before any of these.
+
+  nvramCheck() is the checksum of the blocks other modules keep in the
+  DS1307 battery-backed RAM (ClockDiscipline, SyncState).
+*/
+
+#define RtcCacheAddress   0x68
+#define RtcCacheMaxAgeMs  600000UL  // millis() is good to +-30 s that long
+
+namespace RtcCache {
+  // Whether the oscillator runs (clock halt bit clear)
+  bool running(void);
+  // All time registers, 0 when the DS1307 does not answer
+  time_t read(void);
+  // The seconds register with the rest from the cache
+  time_t readSeconds(void);
+  // Set the time and start the oscillator; restarts the one second countdown
+  void write(time_t t);
+  // Rotate-xor checksum of a block for the DS1307 RAM; a seed per block
+  // keeps one from passing for another
+  uint8_t nvramCheck(const void *data, uint8_t length, uint8_t seed);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "RtcWake.h"
+
+#if defined(NATIVE)
+#include <SimHAL.h>
+#else
+#include <avr/interrupt.h>
+#endif
+
+namespace RtcWake {
+
+  static uint8_t sqwPin;
+  static volatile uint32_t ticks;
+
+  void edge(void)
+  {
+    if (!digitalRead(sqwPin)) ticks++;
+  }
+
+  void begin(RTC_DS1307 &rtc, uint8_t pin)
+  {
+    sqwPin = pin;
+    ticks = 0;
+    pinMode(pin, INPUT_PULLUP);
+    rtc.writeSqwPinMode(DS1307_SquareWave1HZ);
+  #if defined(NATIVE)
+    Sim::attachPinChange(pin, edge);
+  #else
+    if (pin > 7) return;
+    uint8_t sreg = SREG;
+    cli();
+    PCMSK2 |= 1 << pin;
+    PCIFR = 1 << PCIF2;
+    PCICR |= 1 << PCIE2;
+    SREG = sreg;
+  #endif
+  }
+
+  void end(RTC_DS1307 &rtc)
+  {
+  #if defined(NATIVE)
+    Sim::detachPinChange(sqwPin);
+  #else
+    PCMSK2 &= ~(1 << sqwPin);
+    if (PCMSK2 == 0) PCICR &= ~(1 << PCIE2);
+  #endif
+    rtc.writeSqwPinMode(DS1307_OFF);
+  }
+
+  uint32_t seconds(void)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    uint32_t t = ticks;
+    SREG = sreg;
+    return t;
+  }
+}
+
+#if !defined(NATIVE)
+ISR(PCINT2_vect)
+{
+  RtcWake::edge();
+}
+#endif
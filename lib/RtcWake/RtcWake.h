@@ -0,0 +1,26 @@
+#ifndef RTCWAKE_h
+#define RTCWAKE_h
+
+#include <Arduino.h>
+#include <RTClib.h>
+
+/*
+  The DS1307 square wave as seconds counter and wake-up source while the
+  MCU is powered down and millis() stands still.
+
+  begin() switches SQW/OUT to 1 Hz and enables the pin change interrupt of
+  the pin it is wired to (open drain, the internal pull-up is used). Both
+  edges wake the MCU, every falling edge counts a second.
+
+  Only PCINT2 is used: the pin must be on port D, digital pins 0-7. With
+  2 and 3 taken by the DCF77 and PIR interrupts that leaves 4 to 7.
+*/
+
+namespace RtcWake {
+  void begin(RTC_DS1307 &rtc, uint8_t pin);
+  void end(RTC_DS1307 &rtc);
+  // Falling edges since begin()
+  uint32_t seconds(void);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include "SyncState.h"
+#include <RtcCache.h>
+#include <stddef.h>
+
+namespace SyncState {
+
+  struct Stored {
+    uint8_t    version;
+    DCF77State dcf;
+    uint8_t    check;
+  };
+
+  // As last read or written, to skip writes that change nothing
+  static Stored stored;
+
+  static uint8_t checksum(const Stored &s)
+  {
+    return RtcCache::nvramCheck(&s, offsetof(Stored, check), 0x5A);
+  }
+
+  bool load(RTC_DS1307 &rtc, DCF77State &state)
+  {
+    rtc.readnvram((uint8_t *)&stored, sizeof(stored), SyncStateNvramAddress);
+    if (stored.version != SyncStateVersion || stored.check != checksum(stored)) {
+      memset(&stored, 0, sizeof(stored));
+      return false;
+    }
+    state = stored.dcf;
+    return true;
+  }
+
+  void save(RTC_DS1307 &rtc, const DCF77State &state)
+  {
+    Stored s;
+    memset(&s, 0, sizeof(s));
+    s.version = SyncStateVersion;
+    s.dcf = state;
+    s.check = checksum(s);
+    if (memcmp(&s, &stored, sizeof(s)) == 0) return;
+    stored = s;
+    rtc.writenvram(SyncStateNvramAddress, (const uint8_t *)&stored, sizeof(stored));
+  }
+}
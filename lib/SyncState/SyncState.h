@@ -0,0 +1,30 @@
+#ifndef SYNCSTATE_h
+#define SYNCSTATE_h
+
+#include <Arduino.h>
+#include <RTClib.h>
+#include <DCF77.h>
+#include <ClockDiscipline.h>
+
+/*
+  What the DCF77 decoder learned (DCF77State: last accepted minute,
+  pulse clusters and polarity, quality averages), kept in the DS1307
+  battery-backed RAM so a reset does not start reception from scratch.
+
+  The block follows the one of ClockDiscipline, which holds the drift
+  estimate. It carries a version and a checksum; a block that does not
+  match (first start, RTC battery replaced, other firmware) is ignored.
+  save() only writes when something changed. The state is passed as
+  DCF77State, so it comes from one DCF77 or a DCF77Combiner alike.
+*/
+
+#define SyncStateNvramAddress (DisciplineNvramAddress + DisciplineNvramBytes)
+#define SyncStateVersion      2
+
+namespace SyncState {
+  // Read the decoder state from the RTC RAM; false when nothing valid is stored
+  bool load(RTC_DS1307 &rtc, DCF77State &state);
+  void save(RTC_DS1307 &rtc, const DCF77State &state);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "Telemetry.h"
+
+#ifdef TELEMETRY
+
+namespace Telemetry {
+
+  struct Record {
+    uint8_t  type;
+    uint8_t  detail;
+    uint8_t  sequence;
+    uint32_t ms;
+    int32_t  value;
+  };
+
+  static Record ring[TelemetryRingSize];
+  static volatile uint8_t head = 0;
+  static volatile uint8_t tail = 0;
+  static uint8_t  sequence = 0;
+  static uint16_t droppedRecords = 0;
+
+  // Loop work since the last TelemetryLoop record
+  static uint32_t loopStart = 0;
+  static uint32_t loopBusyUs = 0;
+  static uint32_t loopMaxUs = 0;
+
+  static void put32(uint8_t *p, uint32_t v)
+  {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+  }
+
+  /**
+   * Store one record; constant time, also in an interrupt handler. A
+   * dropped record still takes its sequence number
+   */
+  void record(uint8_t type, uint8_t detail, int32_t value)
+  {
+    uint32_t ms = millis();
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t next = (head + 1) & (TelemetryRingSize - 1);
+    if (next == tail) {
+      if (droppedRecords != 0xFFFF) droppedRecords++;
+    } else {
+      Record &r = ring[head];
+      r.type = type;
+      r.detail = detail;
+      r.sequence = sequence;
+      r.ms = ms;
+      r.value = value;
+      head = next;
+    }
+    sequence++;
+    SREG = sreg;
+  }
+
+  void flush(void)
+  {
+    while (tail != head && Serial.availableForWrite() >= TelemetryRecordBytes) {
+      const Record &r = ring[tail];
+      uint8_t out[TelemetryRecordBytes];
+      out[0] = TelemetrySyncByte;
+      out[1] = r.type;
+      out[2] = r.detail;
+      out[3] = r.sequence;
+      put32(out + 4, r.ms);
+      put32(out + 8, r.value);
+      out[12] = telemetryCrc(out + 1, TelemetryRecordBytes - 2);
+      // The slot is free once copied
+      tail = (tail + 1) & (TelemetryRingSize - 1);
+      Serial.write(out, TelemetryRecordBytes);
+    }
+  }
+
+  uint16_t dropped(void)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t n = droppedRecords;
+    SREG = sreg;
+    return n;
+  }
+
+  void loopTime(uint32_t us)
+  {
+    loopBusyUs += us;
+    if (us > loopMaxUs) loopMaxUs = us;
+    uint32_t elapsed = millis() - loopStart;
+    if (elapsed < TelemetryLoopPeriod) return;
+    // us per ms of the period is per mille, a tenth of it whole percent
+    record(TelemetryLoop, loopBusyUs / elapsed / 10, loopMaxUs);
+    loopStart += elapsed;
+    loopBusyUs = 0;
+    loopMaxUs = 0;
+  }
+}
+
+#endif
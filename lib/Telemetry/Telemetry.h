@@ -0,0 +1,121 @@
+#ifndef TELEMETRY_h
+#define TELEMETRY_h
+
+#include <Arduino.h>
+
+/*
+  Binary telemetry over Serial (compile with -D TELEMETRY).
+
+  Events are stored as fixed-size records in a small ring, in constant
+  time, from the main loop or an interrupt handler:
+
+    TELEMETRY_EVENT(TelemetryOffset, source, offsetMs);
+
+  Telemetry::flush(), called from the main loop, moves them into the TX
+  buffer of Serial, which the UART interrupt drains, and only as far as
+  that buffer has room. Nothing waits for the UART, so logging does not
+  change the timing of the clock; when the ring is full, records are
+  dropped and counted.
+
+  Wire format, TelemetryRecordBytes per record, little endian:
+    0      TelemetrySyncByte
+    1      type (TelemetryType)
+    2      detail, meaning by type
+    3      sequence number, also counts dropped records
+    4-7    millis() of the event
+    8-11   value, int32, meaning by type
+    12     telemetryCrc() of bytes 1-11
+  A reader resynchronizes on the next sync byte whose record checks.
+  sim/apps/decode_telemetry.cpp prints a recording as text.
+
+  Without TELEMETRY the macros expand to nothing and no ring exists.
+*/
+
+#define TelemetryVersion     2
+#define TelemetrySyncByte    0xA5
+#define TelemetryRecordBytes 13
+#define TelemetryRingSize    8        // records, power of two
+#define TelemetryLoopPeriod  60000UL  // ms between TelemetryLoop records
+
+enum TelemetryType {
+  TelemetryStart,       // after reset; value TelemetryVersion, detail TelemetryRtc* bits
+  TelemetrySync,        // DCF77 frame accepted; value UTC, detail DCFFlag* bits
+  TelemetryOffset,      // clock against a reference; value ms, detail 0 RTC, 1 DCF77, 2 DCF77 second only
+  TelemetryRtcError,    // DS1307 minus UTC, measured before it is set again; value ms
+  TelemetryRtcSet,      // DS1307 set; value UTC
+  TelemetryDrift,       // DS1307 drift fitted; value ppb, detail number of fits
+  TelemetryReception,   // receiver switched; value ms it was on, detail TelemetryRx*
+  TelemetryQuality,     // each minute of reception; value frame rate %, detail score 0..100
+  TelemetryJitter,      // each minute of reception; value second jitter us, detail 1 locked
+  TelemetryLoop,        // each TelemetryLoopPeriod; value longest dispatch us, detail busy, whole %
+  TelemetryPulses,      // each minute of reception; value short | long << 16 ms, detail TelemetryPulse* bits
+  TelemetryPulseLimits, // each minute of reception; value split | max width << 16 ms, detail min width ms
+  TelemetryPeriod,      // each minute of reception; value learned second in micros() us
+  TelemetryTypes
+};
+
+// TelemetryStart detail
+#define TelemetryRtcFound    0x01
+#define TelemetryRtcRunning  0x02
+
+// TelemetryPulses detail
+#define TelemetryPulseLearned   0x01
+#define TelemetryPulseInverted  0x02
+
+// TelemetryReception detail
+enum {
+  TelemetryRxStart,     // window opened or reception started
+  TelemetryRxDone,      // frame accepted, receiver off
+  TelemetryRxTimeout,   // window over without frame
+  TelemetryRxGiveUp,    // signal too poor
+  TelemetryRxSleep      // off for sleep
+};
+
+// CRC-8, polynomial 0x07, as sent in the last byte of each record
+inline uint8_t telemetryCrc(const uint8_t *data, uint8_t length)
+{
+  uint8_t crc = 0;
+  while (length--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+#ifdef TELEMETRY
+#ifdef DCF_VERBOSE_DEBUG
+#error "TELEMETRY and DCF_VERBOSE_DEBUG both write to Serial; enable only one"
+#endif
+#ifdef DCF_CAPTURE
+#error "TELEMETRY and DCF_CAPTURE both write to Serial; enable only one"
+#endif
+
+namespace Telemetry {
+  void record(uint8_t type, uint8_t detail, int32_t value);
+  // Write pending records to Serial, as far as its TX buffer has room
+  void flush(void);
+  uint16_t dropped(void);
+
+  // Duration of one pass of the loop work, for TelemetryLoop
+  void loopTime(uint32_t micros);
+
+  class LoopScope {
+  public:
+    LoopScope() : _start(micros()) {}
+    ~LoopScope() { loopTime(micros() - _start); }
+  private:
+    uint32_t _start;
+  };
+}
+
+#define TELEMETRY_EVENT(type, detail, value) Telemetry::record((type), (detail), (value))
+#define TELEMETRY_LOOP_SCOPE() Telemetry::LoopScope _telemetryLoop
+
+#else
+
+#define TELEMETRY_EVENT(type, detail, value)
+#define TELEMETRY_LOOP_SCOPE()
+
+#endif
+
+#endif
@@ -0,0 +1,314 @@
+/*
+  bench_decoder - push synthetic DCF77 signal through DCF77::int0handler
+  as fast as the host allows and report decoder throughput and quality.
+
+  Options:
+    --from YYYY-MM-DD[THH:MM]   first simulated minute (UTC)
+    --to   YYYY-MM-DD[THH:MM]   end of the range (UTC, exclusive)
+    --days N                    alternative to --to
+    --jitter MS                 edge jitter (+-MS)
+    --dropout P                 probability of a missing pulse
+    --spikes P                  probability of a spurious spike per second
+    --ber P                     probability of a misread bit
+    --seed N                    PRNG seed
+    --short MS / --long MS      pulse widths of the receiver (100/200)
+    --inverted 1                receiver with inverted output
+    --leap YYYY-MM-DDTHH:00     insert a leap second before this UTC hour
+    --trials N                  repeat the range N times from a cold start,
+                                each with its own noise (seed, seed+1, ...)
+
+  Reported: simulated frames per host second, share of frames decoded to
+  the correct time, wrong decodes (off by more than 20 ms), time from cold start to the first
+  accepted time, and the latency from the minute marker
+  to the time being available in the main loop (virtual time) as well as
+  the host CPU time spent in the getUTCTime() call that produced it.
+  Once the second ticks are locked, the error of getUTCPhase() against
+  the true second edge is sampled at every update, and the decoder's own
+  jitter estimate, the learned pulse parameters and the reception
+  statistics (SignalQuality) of the last trial are reported at the end.
+
+  Announcements are checked on every decoded frame: getFlags() against
+  the transmitted bits 15-19, with A1/A2 only once two frames within
+  five minutes carry them, and announcedAt() against the end of the
+  hour. Each frame goes to LocalClock::transmitted() as in the sketch,
+  once with the CET/CEST rules and once with rules that change at the
+  same instants to other offsets (GMT/BST); both must show CET/CEST at
+  the start of every minute, the DST changes included. The frames also
+  steer ClockDiscipline, which is told of announced leap seconds; while
+  the second ticks are locked it must be within 50 ms of each frame.
+  With DCF_ACCUMULATOR the call and announcement bits are voted over
+  several frames, so they may show up some minutes late but never in
+  a frame that did not carry them.
+  With a clean signal (no --dropout, --spikes or --ber, whose misread
+  bits 15-19 carry no parity) any failed check makes the exit status 1.
+  Whatever the noise, a call bit or announcement that was not sent and
+  a leap second other than --leap are counted as spurious; with
+  DCF_ACCUMULATOR, which is meant for noise, they always fail.
+  E.g.  --from 2024-03-31 --days 1 --leap 2024-03-31T12:00
+*/
+
+#include <Arduino.h>
+#include <SimHAL.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <RTClib.h>
+#include <Timezone.h>
+#include "DCF77.h"
+#include "Time.h"
+#include "DCF77Signal.h"
+#include "LocalClock.h"
+#include "ClockDiscipline.h"
+
+#define DCF_PIN 2
+#define DCF_INTERRUPT 0
+
+typedef std::chrono::steady_clock Clock;
+
+static TimeChangeRule rCEST = {"CEST", Last, Sun, Mar, 2, 120};
+static TimeChangeRule rCET  = {"CET", Last, Sun, Oct, 3, 60};
+// Same instants as CET/CEST, other offsets: only what DCF77 sends is right
+static TimeChangeRule rBST  = {"BST", Last, Sun, Mar, 1, 60};
+static TimeChangeRule rGMT  = {"GMT", Last, Sun, Oct, 2, 0};
+
+// Frame bits 15-19, as DCF77::getFlags() returns them
+static unsigned char sentFlags(time_t minuteUTC, time_t leapSecondUTC)
+{
+  return (DCF77Signal::encodeFrame(minuteUTC, leapSecondUTC) >> 15) & 0x1F;
+}
+
+struct Checks {
+  Checks() : frames(0), flags(0), announced(0), ruleLocal(0), otherLocal(0), clock(0),
+             spuriousFlags(0), spuriousLeaps(0) {}
+  long frames, flags, announced, ruleLocal, otherLocal, clock;
+  long spuriousFlags, spuriousLeaps;
+};
+
+static bool parseTime(const char *s, time_t &out)
+{
+  struct tm t = {};
+  int n = sscanf(s, "%d-%d-%dT%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min);
+  if (n < 3) return false;
+  t.tm_year -= 1900;
+  t.tm_mon -= 1;
+  out = timegm(&t);
+  return true;
+}
+
+static double percentile(std::vector<double> &v, double p)
+{
+  if (v.empty()) return 0;
+  size_t i = size_t(p * (v.size() - 1));
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+  return v[i];
+}
+
+static void report(const char *what, const char *unit, std::vector<double> &v)
+{
+  if (v.empty()) {
+    printf("%-22s n/a\n", what);
+    return;
+  }
+  double sum = 0;
+  for (size_t i = 0; i < v.size(); i++) sum += v[i];
+  double mx = *std::max_element(v.begin(), v.end());
+  double mn = *std::min_element(v.begin(), v.end());
+  printf("%-22s min %.1f  mean %.1f  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f %s\n", what,
+         mn, sum / v.size(), percentile(v, 0.5), percentile(v, 0.95), percentile(v, 0.99), mx, unit);
+}
+
+int main(int argc, char **argv)
+{
+  time_t from = 1704067200;   // 2024-01-01 00:00 UTC
+  time_t to = 0;
+  double days = 1;
+  int trials = 1;
+  SignalOptions options;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char *key = argv[i], *val = argv[i + 1];
+    if      (!strcmp(key, "--from"))    { if (!parseTime(val, from)) { fprintf(stderr, "bad --from\n"); return 1; } }
+    else if (!strcmp(key, "--to"))      { if (!parseTime(val, to))   { fprintf(stderr, "bad --to\n");   return 1; } }
+    else if (!strcmp(key, "--days"))    days = atof(val);
+    else if (!strcmp(key, "--jitter"))  options.jitterMs = atoi(val);
+    else if (!strcmp(key, "--dropout")) options.dropoutRate = atof(val);
+    else if (!strcmp(key, "--spikes"))  options.spikeRate = atof(val);
+    else if (!strcmp(key, "--ber"))     options.bitErrorRate = atof(val);
+    else if (!strcmp(key, "--seed"))    options.seed = atoi(val);
+    else if (!strcmp(key, "--trials"))  trials = atoi(val);
+    else if (!strcmp(key, "--short"))   options.shortPulseMs = atoi(val);
+    else if (!strcmp(key, "--long"))    options.longPulseMs = atoi(val);
+    else if (!strcmp(key, "--inverted")) options.inverted = atoi(val) != 0;
+    else if (!strcmp(key, "--leap"))    { if (!parseTime(val, options.leapSecondUTC)) { fprintf(stderr, "bad --leap\n"); return 1; } }
+    else { fprintf(stderr, "unknown option %s\n", key); return 1; }
+  }
+  from -= from % 60;
+  if (to == 0) to = from + time_t(days * 86400);
+  long minutes = long((to - from) / 60);
+  if (minutes <= 0 || trials <= 0) {
+    fprintf(stderr, "empty range\n");
+    return 1;
+  }
+
+  Sim::reset();
+  Sim::setSerialOutput(NULL);
+  RTC_DS1307 rtc;
+  rtc.begin();
+  Timezone tz(rCEST, rCET);
+  Checks checks;
+
+  std::vector<SignalEdge> edges;
+  std::vector<double> latencyMs, cpuNs, firstSyncMin, phaseErrorUs;
+  unsigned int jitterUs = 0;
+  PulseClassifier::Parameters pulses;
+  SignalQuality quality;
+  long decoded = 0, wrong = 0, neverSynced = 0;
+  unsigned long long edgeCount = 0;
+  uint64_t trialUs = 1000000;
+  uint32_t seed = options.seed;
+
+  Clock::time_point begin = Clock::now();
+  for (int trial = 0; trial < trials; trial++) {
+    // Each trial is a cold start of the decoder on fresh noise
+    options.seed = seed + trial;
+    DCF77Signal signal(options);
+    DCF77 DCF(DCF_PIN, DCF_INTERRUPT);
+    DCF.Start();
+    bool synced = false;
+    uint64_t nextMinuteUs = trialUs;
+    LocalClock ruleLocal(rCEST, rCET), otherLocal(rBST, rGMT);
+    ClockDiscipline::begin(rtc);
+    time_t previousMinute = 0;          // of the frame decoded before
+    unsigned char previousFlags = 0;
+    bool preciseBefore = false;         // the clock had a precise reference
+
+    // One extra minute supplies the marker that completes the last frame
+    for (long m = 0; m <= minutes; m++) {
+      time_t minuteUTC = from + m * 60;
+      uint64_t minuteUs = nextMinuteUs;
+      if (synced) {
+        // Between frames, DST changes included, the offsets come from the last one
+        time_t t = tz.toLocal(minuteUTC);
+        ruleLocal.update(minuteUTC);
+        otherLocal.update(minuteUTC);
+        if (ruleLocal.local() != t) checks.ruleLocal++;
+        if (otherLocal.local() != t) checks.otherLocal++;
+      }
+      edges.clear();
+      nextMinuteUs += signal.appendMinute(minuteUTC, minuteUs, edges) * 1000000ULL;
+      edgeCount += edges.size();
+
+      for (size_t e = 0; e < edges.size(); e++) {
+        Sim::advanceToMicros(edges[e].us);
+        Sim::setPin(DCF_PIN, edges[e].level);
+
+        Clock::time_point t0 = Clock::now();
+        time_t t = DCF.getUTCTime();
+        if (t == 0) continue;
+        cpuNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+        latencyMs.push_back((edges[e].us - minuteUs) / 1000.0);
+        decoded++;
+        // Edges sit on second boundaries: allow the decoder's phase error
+        int64_t sinceMinute = int64_t(edges[e].us - minuteUs);
+        time_t early = minuteUTC + time_t(floor((sinceMinute - 20000) / 1e6));
+        time_t late  = minuteUTC + time_t(floor((sinceMinute + 20000) / 1e6));
+        if (t != early && t != late) wrong++;
+        time_t utc;
+        uint32_t sinceSecond;
+        bool precise = DCF.getUTCPhase(utc, sinceSecond);
+        if (precise) {
+          double measured = double(utc - minuteUTC) * 1e6 + sinceSecond;
+          phaseErrorUs.push_back(fabs(measured - double(Sim::micros64() - minuteUs)));
+        }
+
+        // What the sketch does with the frame, checked
+        unsigned char sent = sentFlags(minuteUTC, options.leapSecondUTC);
+        unsigned char confirmed = minuteUTC - previousMinute > 5 * SECS_PER_MIN ? 0 : previousFlags;
+        unsigned char flags = sent & (confirmed | ~DCFFlagAnnouncements);
+        time_t at = (flags & DCFFlagAnnouncements) && minuteUTC % SECS_PER_HOUR
+                    ? minuteUTC - minuteUTC % SECS_PER_HOUR + SECS_PER_HOUR : 0;
+        checks.frames++;
+        unsigned char got = DCF.getFlags();
+#ifdef DCF_ACCUMULATOR
+        const unsigned char voted = DCFFlagCall | DCFFlagAnnouncements;
+        if ((got & ~voted) != (flags & ~voted) || (got & ~flags)) checks.flags++;
+        if (DCF.announcedAt() != (got & DCFFlagAnnouncements ? at : 0)) checks.announced++;
+#else
+        if (got != flags) checks.flags++;
+        if (DCF.announcedAt() != at) checks.announced++;
+#endif
+        if (got & ~sent & (DCFFlagCall | DCFFlagAnnouncements)) checks.spuriousFlags++;
+        if ((got & DCFFlagLeapSecond) && DCF.announcedAt() && DCF.announcedAt() != options.leapSecondUTC)
+          checks.spuriousLeaps++;
+        previousMinute = minuteUTC;
+        previousFlags = sent;
+        time_t changeAt = DCF.getFlags() & DCFFlagZoneChange ? DCF.announcedAt() : 0;
+        bool cest = DCF.getFlags() & DCFFlagCEST;
+        ruleLocal.transmitted(t, DCF.utcOffset(), cest, changeAt);
+        otherLocal.transmitted(t, DCF.utcOffset(), cest, changeAt);
+
+        uint16_t ms;
+        time_t clockSec = ClockDiscipline::now(&ms);
+        if (precise) {
+          int64_t err = (int64_t(clockSec) - utc) * 1000 + ms - sinceSecond / 1000;
+          if (preciseBefore && (err > 50 || err < -50)) checks.clock++;
+          ClockDiscipline::reference(utc, sinceSecond, true);
+        } else {
+          ClockDiscipline::reference(t, 0, false);
+        }
+        preciseBefore = precise;
+        if (DCF.getFlags() & DCFFlagLeapSecond) ClockDiscipline::leapSecond(DCF.announcedAt());
+        if (!synced) {
+          synced = true;
+          firstSyncMin.push_back((edges[e].us - trialUs) / 60e6);
+        }
+      }
+    }
+    if (!synced) neverSynced++;
+    jitterUs = DCF.secondJitter();
+    DCF.pulseParameters(pulses);
+    quality = DCF.statistics();
+    DCF.Stop();
+    trialUs = nextMinuteUs + 60000000ULL;
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+  long frames = minutes * trials;
+
+  printf("simulated %d x %ld minutes (%.2f days), %llu edges in %.3f s host time\n",
+         trials, minutes, frames / 1440.0, edgeCount, seconds);
+  printf("throughput             %.0f frames/s  (%.1f M edges/s)\n",
+         frames / seconds, edgeCount / seconds / 1e6);
+  printf("decoded                %ld/%ld (%.2f%%), wrong %ld\n",
+         decoded, frames, 100.0 * decoded / frames, wrong);
+  report("time to first sync", "min", firstSyncMin);
+  if (neverSynced) printf("never synced           %ld of %d trials\n", neverSynced, trials);
+  report("marker-to-time latency", "ms", latencyMs);
+  report("getUTCTime cost", "ns", cpuNs);
+  report("second phase error", "us", phaseErrorUs);
+  printf("estimated jitter       %u us (last trial)\n", jitterUs);
+  printf("learned pulses         %s%s short %u  long %u  split %u  accept %u-%u ms\n",
+         pulses.learned ? "" : "(defaults) ", pulses.inverted ? "inverted" : "normal",
+         pulses.shortWidth, pulses.longWidth, pulses.split, pulses.minWidth, pulses.maxWidth);
+  printf("learned gaps           second %u  min gap %u  sync gap %u ms\n",
+         pulses.second, pulses.minGap, pulses.syncGap);
+  printf("announcements          %ld frames, flags wrong %ld, announcedAt wrong %ld\n",
+         checks.frames, checks.flags, checks.announced);
+  printf("local time wrong       %ld minutes (CET rules), %ld minutes (GMT rules)\n",
+         checks.ruleLocal, checks.otherLocal);
+  printf("clock off by > 50 ms   %ld frames\n", checks.clock);
+  printf("spurious               %ld frames with flags not sent, %ld leap seconds not sent\n",
+         checks.spuriousFlags, checks.spuriousLeaps);
+  fflush(stdout);
+  Sim::setSerialOutput(stdout);
+  quality.report(Serial);
+  bool clean = options.dropoutRate == 0 && options.spikeRate == 0 && options.bitErrorRate == 0;
+  bool failed = checks.flags || checks.announced || checks.ruleLocal || checks.otherLocal || checks.clock;
+  bool spurious = checks.spuriousFlags || checks.spuriousLeaps;
+#ifdef DCF_ACCUMULATOR
+  if (spurious) return 1;
+#endif
+  return clean && (failed || spurious) ? 1 : 0;
+}
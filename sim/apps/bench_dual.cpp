@@ -0,0 +1,158 @@
+/*
+  bench_dual - two receivers with their own noise, each decoded by its
+  own DCF77 object (INT0 and INT1), alone and through DCF77Combiner.
+
+  Options:
+    --days N                  minutes simulated per trial (default 1 day)
+    --trials N                cold starts, each with its own noise
+    --seed N                  PRNG seed
+    --jitter MS               edge jitter of both receivers
+    --ber P / --ber2 P        misread bits, first / second receiver
+    --dropout P / --dropout2 P  missing pulses
+    --spikes P / --spikes2 P  spurious spikes per second
+
+  Per setup (first alone, second alone, combined) it reports the minutes
+  decoded to the correct time, wrong decodes and the time from cold start
+  to the first accepted time. Every setup sees the same edges.
+*/
+
+#include <Arduino.h>
+#include <SimHAL.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "DCF77.h"
+#include "DCF77Combiner.h"
+#include "Time.h"
+#include "DCF77Signal.h"
+
+#define DCF_PIN  2
+#define DCF2_PIN 3
+
+struct PinEdge {
+  uint64_t us;
+  uint8_t  pin;
+  uint8_t  level;
+};
+
+static bool byTime(const PinEdge &a, const PinEdge &b)
+{
+  return a.us < b.us;
+}
+
+struct Result {
+  Result() : decoded(0), wrong(0), neverSynced(0) {}
+  long decoded, wrong, neverSynced;
+  std::vector<double> firstSyncMin;
+};
+
+enum Setup { FirstOnly, SecondOnly, Combined, Setups };
+
+static const char *const setupNames[Setups] = { "first alone", "second alone", "combined" };
+
+static void run(Setup setup, SignalOptions a, SignalOptions b, time_t from, long minutes,
+                uint64_t &trialUs, Result &result)
+{
+  DCF77Signal first(a), second(b);
+  DCF77 DCF1(DCF_PIN, 0), DCF2(DCF2_PIN, 1);
+  DCF77Combiner both(DCF1, DCF2);
+  if (setup == Combined) both.Start();
+  else if (setup == FirstOnly) DCF1.Start();
+  else DCF2.Start();
+
+  std::vector<SignalEdge> edges;
+  std::vector<PinEdge> merged;
+  bool synced = false;
+  uint64_t nextMinuteUs = trialUs;
+  for (long m = 0; m <= minutes; m++) {
+    time_t minuteUTC = from + m * 60;
+    uint64_t minuteUs = nextMinuteUs;
+    merged.clear();
+    edges.clear();
+    nextMinuteUs += first.appendMinute(minuteUTC, minuteUs, edges) * 1000000ULL;
+    for (size_t e = 0; e < edges.size(); e++) merged.push_back({edges[e].us, DCF_PIN, edges[e].level});
+    edges.clear();
+    second.appendMinute(minuteUTC, minuteUs, edges);
+    for (size_t e = 0; e < edges.size(); e++) merged.push_back({edges[e].us, DCF2_PIN, edges[e].level});
+    std::stable_sort(merged.begin(), merged.end(), byTime);
+
+    for (size_t e = 0; e < merged.size(); e++) {
+      Sim::advanceToMicros(merged[e].us);
+      Sim::setPin(merged[e].pin, merged[e].level);
+      time_t t = setup == Combined ? both.getUTCTime()
+               : setup == FirstOnly ? DCF1.getUTCTime() : DCF2.getUTCTime();
+      if (t == 0) continue;
+      result.decoded++;
+      int64_t sinceMinute = int64_t(merged[e].us - minuteUs);
+      time_t early = minuteUTC + time_t(floor((sinceMinute - 20000) / 1e6));
+      time_t late  = minuteUTC + time_t(floor((sinceMinute + 20000) / 1e6));
+      if (t != early && t != late) result.wrong++;
+      if (!synced) {
+        synced = true;
+        result.firstSyncMin.push_back((merged[e].us - trialUs) / 60e6);
+      }
+    }
+  }
+  if (!synced) result.neverSynced++;
+  both.Stop();
+  trialUs = nextMinuteUs + 60000000ULL;
+}
+
+int main(int argc, char **argv)
+{
+  time_t from = 1704067200;   // 2024-01-01 00:00 UTC
+  double days = 1;
+  int trials = 1;
+  SignalOptions a, b;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char *key = argv[i], *val = argv[i + 1];
+    if      (!strcmp(key, "--days"))     days = atof(val);
+    else if (!strcmp(key, "--trials"))   trials = atoi(val);
+    else if (!strcmp(key, "--seed"))     a.seed = atoi(val);
+    else if (!strcmp(key, "--jitter"))   a.jitterMs = b.jitterMs = atoi(val);
+    else if (!strcmp(key, "--ber"))      a.bitErrorRate = atof(val);
+    else if (!strcmp(key, "--ber2"))     b.bitErrorRate = atof(val);
+    else if (!strcmp(key, "--dropout"))  a.dropoutRate = atof(val);
+    else if (!strcmp(key, "--dropout2")) b.dropoutRate = atof(val);
+    else if (!strcmp(key, "--spikes"))   a.spikeRate = atof(val);
+    else if (!strcmp(key, "--spikes2"))  b.spikeRate = atof(val);
+    else { fprintf(stderr, "unknown option %s\n", key); return 1; }
+  }
+  long minutes = long(days * 1440);
+  if (minutes <= 0 || trials <= 0) {
+    fprintf(stderr, "empty range\n");
+    return 1;
+  }
+
+  Sim::reset();
+  Sim::setSerialOutput(NULL);
+
+  Result results[Setups];
+  uint64_t trialUs = 1000000;
+  uint32_t seed = a.seed;
+  for (int trial = 0; trial < trials; trial++) {
+    // Both antennas get noise of their own, the same in every setup
+    a.seed = seed + 2 * trial;
+    b.seed = seed + 2 * trial + 1;
+    for (int s = 0; s < Setups; s++) run(Setup(s), a, b, from, minutes, trialUs, results[s]);
+  }
+
+  long frames = minutes * trials;
+  printf("%d x %ld minutes\n", trials, minutes);
+  for (int s = 0; s < Setups; s++) {
+    Result &r = results[s];
+    std::vector<double> &v = r.firstSyncMin;
+    double mean = 0;
+    for (size_t i = 0; i < v.size(); i++) mean += v[i];
+    if (!v.empty()) mean /= v.size();
+    printf("%-13s decoded %ld/%ld (%.2f%%), wrong %ld, first sync mean %.1f max %.1f min",
+           setupNames[s], r.decoded, frames, 100.0 * r.decoded / frames, r.wrong, mean,
+           v.empty() ? 0.0 : *std::max_element(v.begin(), v.end()));
+    if (r.neverSynced) printf(", never synced %ld", r.neverSynced);
+    printf("\n");
+  }
+  return 0;
+}
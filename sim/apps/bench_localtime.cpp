@@ -0,0 +1,103 @@
+/*
+  bench_localtime - compare the display's local time per second through
+  LocalClock against Timezone::toLocal() with hour()/minute()/day()/
+  month()/year() on the result, the path the sketch used before.
+
+  Usage: bench_localtime [days] [seed]
+
+  Both paths step through every second of the given days from
+  2024-01-01 UTC (CET/CEST, so two DST changes a year) and must agree on
+  every field. A second pass checks random jumps, forwards and back.
+  Reports the cost per second (TSC cycles where available, and ns).
+*/
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <chrono>
+#include "Time.h"
+#include <Timezone.h>
+#include "LocalClock.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+static inline uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static TimeChangeRule rCEST = {"CEST", Last, Sun, Mar, 2, 120};
+static TimeChangeRule rCET  = {"CET", Last, Sun, Oct, 3, 60};
+
+static bool same(Timezone &tz, LocalClock &local, time_t utc)
+{
+  time_t t = tz.toLocal(utc);
+  return local.local() == t && local.second() == second(t) && local.minute() == minute(t) &&
+         local.hour() == hour(t) && local.day() == day(t) && local.month() == month(t) &&
+         local.year() == year(t) && local.weekday() == weekday(t) &&
+         local.dst() == tz.utcIsDST(utc) && local.secondsToday() == long(t % SECS_PER_DAY);
+}
+
+int main(int argc, char **argv)
+{
+  long days = argc > 1 ? atol(argv[1]) : 400;
+  uint64_t rng = argc > 2 ? strtoull(argv[2], 0, 10) : 12345;
+  if (days <= 0) days = 1;
+  const time_t from = 1704067200;   // 2024-01-01 00:00 UTC
+  const time_t to = from + days * SECS_PER_DAY;
+
+  Timezone tz(rCEST, rCET);
+  LocalClock local(rCEST, rCET);
+
+  // Correctness, every second and then random jumps
+  long disagree = 0;
+  for (time_t t = from; t < to; t++) {
+    local.update(t);
+    if (!same(tz, local, t) && disagree++ < 5) printf("mismatch at %ld\n", (long)t);
+  }
+  time_t last = to - 1;
+  for (long i = 0; i < 1000000; i++) {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    // Anywhere, or within an hour of the previous time
+    time_t t = (rng >> 33) % 2 ? from + time_t((rng >> 20) % (uint64_t)(to - from))
+                               : last + time_t((rng >> 40) % 7200) - 3600;
+    last = t = t < from ? from : t;
+    local.update(t);
+    if (!same(tz, local, t) && disagree++ < 10) printf("mismatch after jump to %ld\n", (long)t);
+  }
+
+  // Cost of one displayed second: the local fields the sketch reads
+  volatile unsigned sink = 0;
+  Clock::time_point t0 = Clock::now();
+  uint64_t c0 = cycles();
+  for (time_t t = from; t < to; t++) {
+    time_t l = tz.toLocal(t);
+    sink += hour(l) + minute(l) + day(l) + month(l) + year(l);
+  }
+  uint64_t c1 = cycles();
+  Clock::time_point t1 = Clock::now();
+  LocalClock timed(rCEST, rCET);
+  for (time_t t = from; t < to; t++) {
+    timed.update(t);
+    sink += timed.hour() + timed.minute() + timed.day() + timed.month() + timed.year();
+  }
+  uint64_t c2 = cycles();
+  Clock::time_point t2 = Clock::now();
+
+  double count = double(to - from);
+  double legacyNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+  double newNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / count;
+  printf("%ld days, %.0f seconds, %ld disagreements\n", days, count, disagree);
+  if (HAVE_CYCLES) {
+    printf("Timezone::toLocal      %7.1f cycles/s  %6.2f ns/s\n", double(c1 - c0) / count, legacyNs);
+    printf("LocalClock             %7.1f cycles/s  %6.2f ns/s\n", double(c2 - c1) / count, newNs);
+  } else {
+    printf("Timezone::toLocal      %6.2f ns/s\n", legacyNs);
+    printf("LocalClock             %6.2f ns/s\n", newNs);
+  }
+  printf("speedup                %.1fx\n", legacyNs / newNs);
+  return disagree ? 2 : 0;
+}
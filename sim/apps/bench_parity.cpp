@@ -0,0 +1,167 @@
+/*
+  bench_parity - compare the byte-wise FrameDecode path (decode + toTime)
+  against the original bit-serial parity loop, bitfield BCD conversion
+  and makeTime().
+
+  Usage: bench_parity [frames] [seed]
+
+  Half of the frames are valid encodings of random minutes, the rest have
+  1-3 flipped bits. Both decoders run on the same frames; the benchmark
+  reports the cost per frame (TSC cycles where available, and ns) and
+  checks that they agree. The new path additionally rejects BCD digits out
+  of range, which the original accepted; those frames are counted
+  separately.
+*/
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <vector>
+#include <chrono>
+#include "Time.h"
+#include "FrameDecode.h"
+#include "DCF77Signal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+static inline uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// Reference: the decoder as it was before FrameDecode
+namespace Legacy {
+
+  struct DCF77Buffer {
+    unsigned long long prefix     :17;
+    unsigned long long CEST       :1;
+    unsigned long long CET        :1;
+    unsigned long long unused     :2;
+    unsigned long long Min        :7;
+    unsigned long long P1         :1;
+    unsigned long long Hour       :6;
+    unsigned long long P2         :1;
+    unsigned long long Day        :6;
+    unsigned long long Weekday    :3;
+    unsigned long long Month      :5;
+    unsigned long long Year       :8;
+    unsigned long long P3         :1;
+  };
+
+  struct ParityFlags {
+    unsigned char parityFlag    :1;
+    unsigned char parityMin     :1;
+    unsigned char parityHour    :1;
+    unsigned char parityDate    :1;
+  };
+
+  static void calculateBufferParities(unsigned long long processingBuffer, ParityFlags &flags)
+  {
+    flags.parityFlag = 0;
+    for (int pos = 0; pos < 59; pos++) {
+      bool s = (processingBuffer >> pos) & 1;
+      if (pos == 21 || pos == 29 || pos == 36) {
+        flags.parityFlag = 0;
+      }
+      if (pos == 28) { flags.parityMin = flags.parityFlag; }
+      if (pos == 35) { flags.parityHour = flags.parityFlag; }
+      if (pos == 58) { flags.parityDate = flags.parityFlag; }
+      if (s == 1) {
+        flags.parityFlag = flags.parityFlag ^ 1;
+      }
+    }
+  }
+
+  static bool decode(const unsigned long long &processingBuffer, tmElements_t &time)
+  {
+    ParityFlags flags = {0, 0, 0, 0};
+    calculateBufferParities(processingBuffer, flags);
+    const DCF77Buffer *rx_buffer = (const DCF77Buffer *)&processingBuffer;
+    if (flags.parityMin == rx_buffer->P1 &&
+        flags.parityHour == rx_buffer->P2 &&
+        flags.parityDate == rx_buffer->P3 &&
+        rx_buffer->CEST != rx_buffer->CET) {
+      time.Second = 0;
+      time.Minute = rx_buffer->Min - ((rx_buffer->Min / 16) * 6);
+      time.Hour   = rx_buffer->Hour - ((rx_buffer->Hour / 16) * 6);
+      time.Day    = rx_buffer->Day - ((rx_buffer->Day / 16) * 6);
+      time.Month  = rx_buffer->Month - ((rx_buffer->Month / 16) * 6);
+      time.Year   = 2000 + rx_buffer->Year - ((rx_buffer->Year / 16) * 6) - 1970;
+      return true;
+    }
+    return false;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  size_t count = argc > 1 ? strtoul(argv[1], 0, 10) : 1000000;
+  uint64_t rng = argc > 2 ? strtoull(argv[2], 0, 10) : 12345;
+  if (count == 0) count = 1;
+
+  std::vector<unsigned long long> frames(count);
+  for (size_t i = 0; i < count; i++) {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    time_t minute = 946684800 + time_t((rng >> 33) % (100ULL * 365 * 1440)) * 60;
+    unsigned long long f = DCF77Signal::encodeFrame(minute);
+    if (i & 1) {
+      int flips = 1 + (rng >> 20) % 3;
+      for (int k = 0; k < flips; k++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        f ^= 1ULL << ((rng >> 40) % 59);
+      }
+    }
+    frames[i] = f;
+  }
+
+  // Correctness: both paths must agree on every frame
+  size_t accepted = 0, disagree = 0, rangeRejects = 0;
+  for (size_t i = 0; i < count; i++) {
+    tmElements_t ref;
+    FrameDecode::Fields fields;
+    bool a = Legacy::decode(frames[i], ref);
+    bool b = FrameDecode::decode((const uint8_t *)&frames[i], fields);
+    if (b) accepted++;
+    if (a && !b && FrameDecode::paritiesOk((const uint8_t *)&frames[i])) {
+      rangeRejects++;
+    } else if (a != b || (a && (ref.Minute != fields.time.Minute || ref.Hour != fields.time.Hour ||
+                                ref.Day != fields.time.Day || ref.Month != fields.time.Month ||
+                                ref.Year != fields.time.Year ||
+                                makeTime(ref) != FrameDecode::toTime(fields)))) {
+      disagree++;
+    }
+  }
+
+  volatile unsigned sink = 0;
+  Clock::time_point t0 = Clock::now();
+  uint64_t c0 = cycles();
+  for (size_t i = 0; i < count; i++) {
+    tmElements_t tm;
+    sink += Legacy::decode(frames[i], tm) ? makeTime(tm) : 0;
+  }
+  uint64_t c1 = cycles();
+  Clock::time_point t1 = Clock::now();
+  for (size_t i = 0; i < count; i++) {
+    FrameDecode::Fields fields;
+    sink += FrameDecode::decode((const uint8_t *)&frames[i], fields) ? FrameDecode::toTime(fields) : 0;
+  }
+  uint64_t c2 = cycles();
+  Clock::time_point t2 = Clock::now();
+
+  double legacyNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+  double newNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / count;
+  printf("%zu frames, %zu accepted, %zu rejected for BCD range only, %zu disagreements\n",
+         count, accepted, rangeRejects, disagree);
+  if (HAVE_CYCLES) {
+    printf("original               %7.1f cycles/frame  %6.2f ns/frame\n", double(c1 - c0) / count, legacyNs);
+    printf("FrameDecode            %7.1f cycles/frame  %6.2f ns/frame\n", double(c2 - c1) / count, newNs);
+  } else {
+    printf("original               %6.2f ns/frame\n", legacyNs);
+    printf("FrameDecode            %6.2f ns/frame\n", newNs);
+  }
+  printf("speedup                %.1fx\n", legacyNs / newNs);
+  return disagree ? 2 : 0;
+}
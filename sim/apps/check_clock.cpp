@@ -0,0 +1,167 @@
+/*
+  check_clock - run ClockDiscipline for some days against a drifting
+  DS1307 and a mistuned ATmega oscillator, with DCF77 only in short
+  reception windows, and check that the clock never jumps.
+
+  Virtual time is UTC. The DS1307 runs --rtc-ppm fast and starts
+  --rtc-offset-ms late, the ATmega oscillator runs --osc-ppm fast. Every
+  --sync-h hours DCF77 gives a precise reference once a minute for
+  --window-min minutes; in between only the RTC is followed. The loop
+  calls track() every --loop-ms like the dispatcher task does.
+
+  Options:
+    --days N             length of the run (default 4)
+    --rtc-ppm P          DS1307 rate error (default 25)
+    --osc-ppm P          ATmega oscillator rate error (default 3000)
+    --rtc-offset-ms MS   initial DS1307 phase error (default 300)
+    --sync-h H           hours between reception windows (default 12)
+    --window-min M       references per window (default 3)
+    --loop-ms MS         track() period (default 1)
+
+  Without options it runs the defaults and again with --loop-ms 20, a
+  loop too slow to catch the RTC edge within DisciplinePreciseMs.
+
+  Checked, exit status 1 on failure:
+    - the clock second only ever moves on by one, and consecutive
+      seconds are 1 s apart within the slew limit (plus one loop period);
+      the one exception is a window that finds the clock more than
+      DisciplineStepMs off, which steps it once
+    - the fitted DS1307 drift ends within 1 ppm of the truth
+    - once the drift is fitted, the error just before a window stays
+      within DisciplineMaxErrorMs
+*/
+
+#include <Arduino.h>
+#include <SimHAL.h>
+#include <RTClib.h>
+#include <stdio.h>
+#include <string.h>
+#include "ClockDiscipline.h"
+
+struct Options {
+  Options() : days(4), rtcPpm(25), oscPpm(3000), rtcOffsetMs(300), syncH(12), windowMin(3), loopMs(1) {}
+  long days, rtcPpm, oscPpm, rtcOffsetMs, syncH, windowMin;
+  unsigned loopMs;
+};
+
+static bool run(const Options &o)
+{
+  const long days = o.days, rtcPpm = o.rtcPpm, oscPpm = o.oscPpm, syncH = o.syncH, windowMin = o.windowMin;
+  const unsigned loopMs = o.loopMs;
+
+  // UTC at virtual time 0
+  const int64_t epochMs = 1704067200000LL;   // 2024-01-01 00:00
+
+  Sim::reset();
+  Sim::setSerialOutput(NULL);
+  Sim::setOscillatorPpm(oscPpm);
+  Sim::advanceMillis(o.rtcOffsetMs);
+  Sim::rtcSet(epochMs / 1000);
+  Sim::rtcSetDrift(rtcPpm);
+  RTC_DS1307 rtc;
+  ClockDiscipline::begin(rtc);
+
+  // Slewing back by 1/SlewDiv stretches a second to SlewDiv/(SlewDiv-1) s
+  const int64_t slewLimitMs = 1000 / (DisciplineSlewDiv - 1) + loopMs + 2;
+  uint64_t endUs = uint64_t(days) * 86400000000ULL;
+  uint32_t lastSec = 0;
+  int64_t lastChangeMs = -1;
+  long seconds = 0, jumps = 0, irregular = 0, windows = 0, steps = 0, stepped = 0;
+  int64_t maxInterval = 0, minInterval = 1000000, maxError = 0, maxPreSyncError = 0;
+  long nextRefMin = 60;                      // first window after one hour
+
+  while (Sim::micros64() < endUs) {
+    int64_t truthMs = epochMs + int64_t(Sim::micros64() / 1000);
+    int64_t sinceStartMs = truthMs - epochMs;
+
+    // DCF77 window: one reference a minute
+    long minuteNow = long(sinceStartMs / 60000);
+    if (minuteNow >= nextRefMin) {
+      long inWindow = (nextRefMin - 60) % (syncH * 60);
+      uint16_t ms;
+      uint32_t sec = ClockDiscipline::now(&ms);
+      if (inWindow == 0) {
+        int64_t err = int64_t(sec) * 1000 + ms - truthMs;
+        if (err < 0) err = -err;
+        windows++;
+        // The first window sets the RTC, the second fits the drift
+        if (windows > 2 && err > maxPreSyncError) maxPreSyncError = err;
+        // Until then the DS1307 may have drifted past the step threshold
+        if (err > DisciplineStepMs) steps++;
+      }
+      uint64_t us = Sim::micros64() + uint64_t(epochMs) * 1000;
+      ClockDiscipline::reference(us / 1000000, us % 1000000, true);
+      nextRefMin = inWindow + 1 < windowMin ? nextRefMin + 1 : nextRefMin - inWindow + syncH * 60;
+    }
+
+    ClockDiscipline::track();
+    uint16_t ms;
+    uint32_t sec = ClockDiscipline::now(&ms);
+    truthMs = epochMs + int64_t(Sim::micros64() / 1000);
+    int64_t err = int64_t(sec) * 1000 + ms - truthMs;
+    if (err < 0) err = -err;
+    if (err > maxError) maxError = err;
+
+    if (sec != lastSec) {
+      if (lastChangeMs >= 0) {
+        int64_t interval = truthMs - lastChangeMs;
+        if (sec != lastSec + 1 && steps) {
+          steps--;
+          stepped++;
+        } else {
+          if (sec != lastSec + 1) jumps++;
+          if (interval > maxInterval) maxInterval = interval;
+          if (interval < minInterval) minInterval = interval;
+          if (interval > 1000 + slewLimitMs || interval < 1000 - slewLimitMs) irregular++;
+        }
+        seconds++;
+      }
+      lastSec = sec;
+      lastChangeMs = truthMs;
+    }
+    Sim::advanceMillis(loopMs);
+  }
+
+  int32_t drift = ClockDiscipline::driftPpb();
+  printf("%ld days, DS1307 %+ld ppm, oscillator %+ld ppm, window every %ld h, loop %u ms\n",
+         days, rtcPpm, oscPpm, syncH, loopMs);
+  printf("seconds %ld  jumps %ld  interval %lld..%lld ms (limit 1000 +- %lld), %ld outside, %ld stepped\n",
+         seconds, jumps, (long long)minInterval, (long long)maxInterval, (long long)slewLimitMs, irregular, stepped);
+  printf("drift fitted %+.3f ppm  residual %.3f ppm  sync gap %lu s\n",
+         drift / 1000.0, ClockDiscipline::residualPpb() / 1000.0,
+         (unsigned long)ClockDiscipline::syncGap());
+  printf("error max %lld ms, before windows %lld ms (limit %d), %ld windows\n",
+         (long long)maxError, (long long)maxPreSyncError, DisciplineMaxErrorMs, windows);
+
+  bool ok = jumps == 0 && irregular == 0;
+  if (drift - rtcPpm * 1000 > 1000 || drift - rtcPpm * 1000 < -1000) ok = false;
+  if (maxPreSyncError > DisciplineMaxErrorMs) ok = false;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  Options o;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char *key = argv[i], *val = argv[i + 1];
+    if      (!strcmp(key, "--days"))          o.days = atol(val);
+    else if (!strcmp(key, "--rtc-ppm"))       o.rtcPpm = atol(val);
+    else if (!strcmp(key, "--osc-ppm"))       o.oscPpm = atol(val);
+    else if (!strcmp(key, "--rtc-offset-ms")) o.rtcOffsetMs = atol(val);
+    else if (!strcmp(key, "--sync-h"))        o.syncH = atol(val);
+    else if (!strcmp(key, "--window-min"))    o.windowMin = atol(val);
+    else if (!strcmp(key, "--loop-ms"))       o.loopMs = atoi(val);
+    else { fprintf(stderr, "unknown option %s\n", key); return 1; }
+  }
+  if (o.days <= 0 || o.syncH <= 0 || o.windowMin <= 0 || o.loopMs == 0 || o.rtcOffsetMs < 0) {
+    fprintf(stderr, "bad options\n");
+    return 1;
+  }
+  if (argc > 1) return run(o) ? 0 : 1;
+
+  bool ok = run(o);
+  o.loopMs = 20;
+  ok = run(o) && ok;
+  return ok ? 0 : 1;
+}
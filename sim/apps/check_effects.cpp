@@ -0,0 +1,192 @@
+/*
+  check_effects - run the display effects of FidelioAnimator next to the
+  DCF77 decoder the way loop() does and check their timing.
+
+  A simulated loop() calls DCF.getUTCTime() and animator.tick() every
+  --loop-ms of virtual time while a clean synthetic DCF77 signal drives the
+  decoder through its interrupt. Every --stall-every-s seconds one
+  iteration takes --stall-ms longer (an RTC write, a long display
+  update...). Scroll, blink, page rotation and fades take turns on the
+  display.
+
+  Options:
+    --minutes N          length of the run (default 10)
+    --loop-ms MS         loop() period (default 2)
+    --stall-ms MS        length of an injected stall (default 150)
+    --stall-every-s S    stall period, 0 disables (default 7)
+
+  Checked, exit status 1 on failure:
+    - cost of one tick() (virtual time, SPI transfers included)
+    - no two steps of an effect come closer than half their nominal
+      interval: late ticks never make the effects catch up in a burst
+    - the mean step interval of every effect is within 1% of nominal,
+      plus what the stalls account for
+    - the decoder still accepts every frame
+*/
+
+#include <Arduino.h>
+#include <SimHAL.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "DCF77.h"
+#include "Time.h"
+#include "DCF77Signal.h"
+#include "fidelio_display.h"
+#include "fidelio_animator.h"
+
+#define DCF_PIN 2
+#define DCF_INTERRUPT 0
+
+static const double maxTickCostUs = 1000;
+
+struct StepStats {
+  StepStats(const char *name, unsigned nominalMs) : name(name), nominalMs(nominalMs),
+    steps(0), intervals(0), sumMs(0), minMs(1e9), maxMs(0), lastMs(-1) {}
+  const char *name;
+  unsigned nominalMs;
+  long steps, intervals;
+  double sumMs, minMs, maxMs, lastMs;
+
+  void step(double ms) {
+    steps++;
+    if (lastMs >= 0) {
+      double d = ms - lastMs;
+      intervals++;
+      sumMs += d;
+      if (d < minMs) minMs = d;
+      if (d > maxMs) maxMs = d;
+    }
+    lastMs = ms;
+  }
+  // A new run of the effect: the gap to the previous run is no interval
+  void restart() { lastMs = -1; }
+};
+
+static void pageHour(FidelioDisplay &d) { d.printTime(12, 34); }
+static void pageDate(FidelioDisplay &d) { d.printTime(17, 10); }
+static void pageYear(FidelioDisplay &d) { d.print(2026); }
+static const FidelioAnimator::Page pages[] = {pageHour, pageDate, pageYear};
+
+int main(int argc, char **argv)
+{
+  long minutes = 10;
+  unsigned loopMs = 2, stallMs = 150, stallEveryS = 7;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char *key = argv[i], *val = argv[i + 1];
+    if      (!strcmp(key, "--minutes"))       minutes = atol(val);
+    else if (!strcmp(key, "--loop-ms"))       loopMs = atoi(val);
+    else if (!strcmp(key, "--stall-ms"))      stallMs = atoi(val);
+    else if (!strcmp(key, "--stall-every-s")) stallEveryS = atoi(val);
+    else { fprintf(stderr, "unknown option %s\n", key); return 1; }
+  }
+  if (minutes <= 0 || loopMs == 0) {
+    fprintf(stderr, "bad options\n");
+    return 1;
+  }
+
+  Sim::reset();
+  Sim::setSerialOutput(NULL);
+  DCF77 DCF(DCF_PIN, DCF_INTERRUPT);
+  FidelioDisplay display(13, 14, 10, 250000UL);
+  FidelioAnimator animator(display);
+  DCF.Start();
+  display.init();
+
+  // The signal, one extra minute supplies the marker of the last frame
+  time_t from = 1704067200;   // 2024-01-01 00:00 UTC
+  uint64_t startUs = 1000000;
+  DCF77Signal signal;
+  std::vector<SignalEdge> edges;
+  for (long m = 0; m <= minutes; m++) {
+    signal.appendMinute(from + m * 60, startUs + uint64_t(m) * 60000000ULL, edges);
+  }
+  uint64_t endUs = startUs + uint64_t(minutes) * 60000000ULL + 1000000;
+
+  static const unsigned scrollMs = 250, blinkMs = 400, holdMs = 1500, fadeMs = 60;
+  StepStats scrollStats("scroll", scrollMs), blinkStats("blink", blinkMs / 2),
+            rotateStats("rotate", holdMs), fadeStats("fade", fadeMs);
+  StepStats *content = 0;
+  int next = 0;
+  long decoded = 0, ticks = 0, stalls = 0;
+  double costSum = 0, costMax = 0;
+  uint64_t nextStallUs = startUs + uint64_t(stallEveryS) * 1000000ULL;
+
+  size_t e = 0;
+  uint64_t t = startUs;
+  Sim::clearSpiLog();
+  while (t < endUs) {
+    // Receiver edges up to this loop() iteration, through the interrupt
+    while (e < edges.size() && edges[e].us <= t) {
+      Sim::advanceToMicros(edges[e].us);
+      Sim::setPin(DCF_PIN, edges[e].level);
+      e++;
+    }
+    Sim::advanceToMicros(t);
+
+    // loop()
+    if (DCF.getUTCTime() != 0) decoded++;
+    if (!animator.busy()) {
+      // Next effect in turn
+      if (content) content->restart();
+      switch (next++ % 3) {
+        case 0: animator.rotate(pages, 3, holdMs); content = &rotateStats; break;
+        case 1: animator.blink(0x0C, blinkMs, 5); content = &blinkStats; break;   // the last page
+        case 2: animator.scroll("dcf77 Frankfurt  SYnC", scrollMs); content = &scrollStats; break;
+      }
+    }
+    if (!animator.fading()) {
+      fadeStats.restart();
+      animator.fade(next & 1 ? 0 : 7, next & 1 ? 7 : 0, fadeMs);
+    }
+    Sim::clearSpiLog();
+    uint64_t t0 = Sim::micros64();
+    animator.tick(millis());
+    double cost = double(Sim::micros64() - t0);
+    double ms = t0 / 1000.0;
+    ticks++;
+    costSum += cost;
+    if (cost > costMax) costMax = cost;
+    // What went out: brightness commands are fade steps, the rest content
+    bool contentStep = false, fadeStep = false;
+    for (size_t i = 0; i < Sim::spiLog().size(); i++) {
+      const Sim::SPITransaction &tr = Sim::spiLog()[i];
+      if (tr.size() == 1 && (tr[0] & 0xF0) == 0x80) fadeStep = true;
+      else if (tr.size() > 1) contentStep = true;
+    }
+    if (contentStep && content) content->step(ms);
+    if (fadeStep) fadeStats.step(ms);
+
+    t = Sim::micros64() + loopMs * 1000;
+    if (stallEveryS && t >= nextStallUs) {
+      t += stallMs * 1000;
+      nextStallUs += uint64_t(stallEveryS) * 1000000ULL;
+      stalls++;
+    }
+  }
+  DCF.Stop();
+
+  printf("%ld min, loop every %u ms, %ld stalls of %u ms\n", minutes, loopMs, stalls, stallMs);
+  printf("tick cost              mean %.1f  max %.1f us (limit %.0f)\n",
+         costSum / ticks, costMax, maxTickCostUs);
+  bool ok = costMax <= maxTickCostUs;
+
+  StepStats *all[] = {&scrollStats, &blinkStats, &rotateStats, &fadeStats};
+  for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+    StepStats &s = *all[i];
+    double mean = s.intervals ? s.sumMs / s.intervals : 0;
+    // Stalls make single intervals long; the schedule must not make up for
+    // them with short ones, and must not drift
+    bool early = s.intervals && s.minMs < s.nominalMs / 2.0;
+    bool drift = !s.intervals || mean < s.nominalMs * 0.99 || mean > s.nominalMs * 1.01 + stallMs * stalls / double(s.intervals);
+    printf("%-8s %6ld steps  interval nominal %u  mean %.2f  min %.1f  max %.1f ms%s%s\n",
+           s.name, s.steps, s.nominalMs, mean, s.intervals ? s.minMs : 0, s.maxMs,
+           early ? "  EARLY" : "", drift ? "  DRIFT" : "");
+    ok = ok && !early && !drift;
+  }
+
+  printf("frames decoded         %ld of %ld\n", decoded, minutes - 1);
+  if (decoded < minutes - 1) ok = false;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
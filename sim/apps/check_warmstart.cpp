@@ -0,0 +1,186 @@
+/*
+  check_warmstart - the decoder state kept in the DS1307 RAM (SyncState)
+  across a reset, as the sketch does it: load() and restore() after the
+  reset, state() and save() with each accepted frame.
+
+  For a receiver with textbook pulses and for an inverted one with the
+  130/230 ms pulses real modules give, checked, exit status 1 on failure:
+    - blank RAM, a block with a bad checksum and one with another
+      version do not load; the ClockDiscipline block before it is left
+      alone
+    - a saved state loads as it was saved and seeds the pulses
+    - after a reset with the RTC stopped, the first complete frame within
+      DCFWarmStartAge of the saved one is accepted (1 minute), where a
+      cold start needs two (2 minutes); a saved frame older than that
+      does not count, nor does a corrupt block
+    - the accepted time is the transmitted one
+*/
+
+#include <Arduino.h>
+#include <SimHAL.h>
+#include <RTClib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "DCF77.h"
+#include "DCF77Signal.h"
+#include "RtcCache.h"
+#include "SyncState.h"
+
+#define DCF_PIN 2
+#define DCF_INTERRUPT 0
+
+// The block as SyncState.cpp lays it out
+struct Stored {
+  uint8_t    version;
+  DCF77State dcf;
+  uint8_t    check;
+};
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+  printf("  %-52s %s\n", what, ok ? "ok" : "FAILED");
+  if (!ok) failures++;
+}
+
+static uint64_t nowUs = 1000000;
+
+// Run the signal from minute from until the decoder accepts a frame, at
+// most maxMinutes; minutes it took, -1 for none. The frame sent in a
+// minute is complete with the marker that starts the next one
+static double receive(DCF77 &DCF, const SignalOptions &options, time_t from, int maxMinutes,
+                      time_t &accepted)
+{
+  DCF77Signal signal(options);
+  std::vector<SignalEdge> edges;
+  uint64_t startUs = nowUs;
+  accepted = 0;
+  DCF.Start();
+  for (int m = 0; m < maxMinutes; m++) {
+    time_t minuteUTC = from + m * 60;
+    uint64_t minuteUs = nowUs;
+    edges.clear();
+    nowUs += signal.appendMinute(minuteUTC, minuteUs, edges) * 1000000ULL;
+    for (size_t e = 0; e < edges.size(); e++) {
+      Sim::advanceToMicros(edges[e].us);
+      Sim::setPin(DCF_PIN, edges[e].level);
+      time_t t = DCF.getUTCTime();
+      if (t == 0) continue;
+      DCF.Stop();
+      accepted = t;
+      return (edges[e].us - startUs) / 60e6;
+    }
+  }
+  DCF.Stop();
+  return -1;
+}
+
+static void save(RTC_DS1307 &rtc, DCF77 &DCF)
+{
+  DCF77State learned;
+  DCF.state(learned);
+  SyncState::save(rtc, learned);
+}
+
+// After a reset: restore what the RAM holds, the RTC stopped
+static double warmStart(RTC_DS1307 &rtc, const SignalOptions &options, time_t from, bool &loaded,
+                        time_t &accepted)
+{
+  Sim::rtcHalt();
+  DCF77 DCF(DCF_PIN, DCF_INTERRUPT);
+  DCF77State learned;
+  loaded = SyncState::load(rtc, learned);
+  if (loaded) DCF.restore(learned);
+  return receive(DCF, options, from, 10, accepted);
+}
+
+static void check(const char *name, const SignalOptions &options)
+{
+  printf("%s\n", name);
+  Sim::reset();
+  Sim::setSerialOutput(NULL);
+  nowUs = 1000000;
+  RTC_DS1307 rtc;
+  rtc.begin();
+  const time_t from = 1704067200;   // 2024-01-01 00:00 UTC
+
+  DCF77State learned;
+  expect(!SyncState::load(rtc, learned), "blank RAM does not load");
+
+  // Something in the ClockDiscipline block
+  uint8_t discipline[DisciplineNvramBytes];
+  for (uint8_t i = 0; i < sizeof(discipline); i++) discipline[i] = 0xC0 + i;
+  rtc.writenvram(DisciplineNvramAddress, discipline, sizeof(discipline));
+
+  time_t accepted;
+  DCF77 cold(DCF_PIN, DCF_INTERRUPT);
+  double coldMin = receive(cold, options, from, 10, accepted);
+  printf("  cold start %.1f min\n", coldMin);
+  expect(coldMin > 1.5 && accepted == from + (time_t)(coldMin + 0.5) * 60, "cold start needs two frames");
+  DCF77State saved;
+  cold.state(saved);
+  save(rtc, cold);
+
+  uint8_t after[DisciplineNvramBytes];
+  rtc.readnvram(after, sizeof(after), DisciplineNvramAddress);
+  expect(memcmp(discipline, after, sizeof(after)) == 0, "ClockDiscipline block left alone");
+
+  memset(&learned, 0, sizeof(learned));
+  bool loaded = SyncState::load(rtc, learned);
+  expect(loaded && memcmp(&learned, &saved, sizeof(saved)) == 0, "saved state loads as saved");
+  expect(saved.shortWidth != 0 && (bool)saved.inverted == options.inverted, "pulses and polarity saved");
+  DCF77 seeded(DCF_PIN, DCF_INTERRUPT);
+  seeded.restore(learned);
+  PulseClassifier::Parameters pulses;
+  seeded.pulseParameters(pulses);
+  expect(pulses.learned && pulses.shortWidth == saved.shortWidth && pulses.inverted == options.inverted,
+         "restore() seeds the pulses");
+
+  // The block as stored, to corrupt copies of it
+  Stored block;
+  rtc.readnvram((uint8_t *)&block, sizeof(block), SyncStateNvramAddress);
+  Stored bad = block;
+  bad.dcf.utc ^= 0x100;
+  rtc.writenvram(SyncStateNvramAddress, (const uint8_t *)&bad, sizeof(bad));
+  expect(!SyncState::load(rtc, learned), "bad checksum does not load");
+  bad = block;
+  bad.version++;
+  bad.check = RtcCache::nvramCheck(&bad, offsetof(Stored, check), 0x5A);
+  rtc.writenvram(SyncStateNvramAddress, (const uint8_t *)&bad, sizeof(bad));
+  expect(!SyncState::load(rtc, learned), "other version does not load");
+  rtc.writenvram(SyncStateNvramAddress, (const uint8_t *)&block, sizeof(block));
+
+  // An hour after the saved frame
+  time_t later = from + SECS_PER_HOUR;
+  double warmMin = warmStart(rtc, options, later, loaded, accepted);
+  printf("  warm start %.1f min\n", warmMin);
+  expect(loaded && warmMin > 0 && warmMin < 1.5 && accepted == later + 60, "warm start takes the first frame");
+
+  // Longer ago than DCFWarmStartAge
+  time_t stale = later + DCFWarmStartAge + SECS_PER_HOUR;
+  double staleMin = warmStart(rtc, options, stale, loaded, accepted);
+  expect(loaded && staleMin > 1.5, "saved frame too old: two frames");
+
+  rtc.writenvram(SyncStateNvramAddress, (const uint8_t *)&bad, sizeof(bad));
+  double corruptMin = warmStart(rtc, options, stale + SECS_PER_HOUR, loaded, accepted);
+  expect(!loaded && corruptMin > 1.5, "corrupt block: cold start");
+}
+
+int main()
+{
+  SignalOptions textbook;
+  check("textbook receiver", textbook);
+
+  SignalOptions inverted;
+  inverted.inverted = true;
+  inverted.shortPulseMs = 130;
+  inverted.longPulseMs = 230;
+  inverted.seed = 7;
+  check("inverted receiver, 130/230 ms", inverted);
+
+  printf("%s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
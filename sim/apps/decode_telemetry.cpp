@@ -0,0 +1,163 @@
+/*
+  decode_telemetry - print a binary telemetry recording (see
+  lib/Telemetry/Telemetry.h) as text.
+
+  Usage: decode_telemetry [recording.tlm]     (stdin without a file)
+
+  Bytes that do not form a record with a valid CRC (serial monitor
+  banners, line noise) are skipped up to the next sync byte. Gaps in the
+  sequence numbers are records the firmware dropped because its ring was
+  full; a Start record begins a new sequence.
+*/
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "Time.h"
+#include "Telemetry.h"
+#include "DCF77.h"
+
+static const char *const typeNames[TelemetryTypes] = {
+  "start", "sync", "offset", "rtc error", "rtc set", "drift", "reception", "quality", "jitter", "loop",
+  "pulses", "limits", "period"
+};
+
+static const char *const sourceNames[] = { "RTC", "DCF77", "DCF77 second" };
+
+static const char *const rxNames[] = { "start", "done", "timeout", "give up", "sleep" };
+
+static uint32_t get32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+static void printUtc(uint32_t t)
+{
+  tmElements_t tm;
+  breakTime(t, tm);
+  printf("%04d-%02d-%02d %02d:%02d:%02d UTC", tmYearToCalendar(tm.Year), tm.Month, tm.Day,
+         tm.Hour, tm.Minute, tm.Second);
+}
+
+static void printRecord(const uint8_t *r)
+{
+  uint8_t type = r[1], detail = r[2];
+  uint32_t ms = get32(r + 4);
+  int32_t value = (int32_t)get32(r + 8);
+
+  printf("%10lu.%03lu  %3u  ", (unsigned long)(ms / 1000), (unsigned long)(ms % 1000), r[3]);
+  if (type >= TelemetryTypes) {
+    printf("type %u  detail %u  value %ld\n", type, detail, (long)value);
+    return;
+  }
+  printf("%-10s ", typeNames[type]);
+  switch (type) {
+  case TelemetryStart:
+    printf("version %ld, RTC %s%s", (long)value, detail & TelemetryRtcFound ? "found" : "missing",
+           detail & TelemetryRtcRunning ? ", running" : "");
+    break;
+  case TelemetrySync:
+    printUtc(value);
+    if (detail & DCFFlagCEST) printf(", CEST");
+    if (detail & DCFFlagCET) printf(", CET");
+    if (detail & DCFFlagZoneChange) printf(", zone change due");
+    if (detail & DCFFlagLeapSecond) printf(", leap second due");
+    if (detail & DCFFlagCall) printf(", call bit");
+    break;
+  case TelemetryOffset:
+    printf("%+ld ms against %s", (long)value,
+           detail < sizeof(sourceNames) / sizeof(sourceNames[0]) ? sourceNames[detail] : "?");
+    break;
+  case TelemetryRtcError:
+    printf("%+ld ms", (long)value);
+    break;
+  case TelemetryRtcSet:
+    printUtc(value);
+    break;
+  case TelemetryDrift:
+    printf("%+.3f ppm after %u fits", value / 1000.0, detail);
+    break;
+  case TelemetryReception:
+    printf("%s", detail < sizeof(rxNames) / sizeof(rxNames[0]) ? rxNames[detail] : "?");
+    if (detail != TelemetryRxStart) printf(" after %.1f s", value / 1000.0);
+    break;
+  case TelemetryQuality:
+    printf("score %u, frames %ld%%", detail, (long)value);
+    break;
+  case TelemetryJitter:
+    printf("%ld us, %s", (long)value, detail ? "locked" : "not locked");
+    break;
+  case TelemetryLoop:
+    printf("busy %u%%, longest %ld us", detail, (long)value);
+    break;
+  case TelemetryPulses:
+    printf("short %lu, long %lu ms, %s%s", (unsigned long)(value & 0xFFFF), (unsigned long)((uint32_t)value >> 16),
+           detail & TelemetryPulseLearned ? "learned" : "defaults",
+           detail & TelemetryPulseInverted ? ", inverted" : "");
+    break;
+  case TelemetryPulseLimits:
+    printf("accept %u-%lu ms, split %lu ms", detail, (unsigned long)((uint32_t)value >> 16),
+           (unsigned long)(value & 0xFFFF));
+    break;
+  case TelemetryPeriod:
+    printf("second %ld us", (long)value);
+    break;
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+  FILE *in = stdin;
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1])) {
+    fprintf(stderr, "usage: %s [recording.tlm]\n", argv[0]);
+    return 1;
+  }
+  if (argc == 2 && strcmp(argv[1], "-")) {
+    in = fopen(argv[1], "rb");
+    if (!in) {
+      fprintf(stderr, "cannot open %s\n", argv[1]);
+      return 1;
+    }
+  }
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) data.insert(data.end(), buf, buf + n);
+  if (in != stdin) fclose(in);
+
+  unsigned long records = 0, dropped = 0, skipped = 0, resyncs = 0, starts = 0;
+  bool inSync = false, haveSequence = false;
+  uint8_t expected = 0;
+  size_t pos = 0;
+  while (pos + TelemetryRecordBytes <= data.size()) {
+    const uint8_t *r = &data[pos];
+    if (r[0] != TelemetrySyncByte || telemetryCrc(r + 1, TelemetryRecordBytes - 2) != r[12]) {
+      if (inSync) resyncs++;
+      inSync = false;
+      skipped++;
+      pos++;
+      continue;
+    }
+    inSync = true;
+    if (r[1] == TelemetryStart) {
+      starts++;
+      haveSequence = false;
+    }
+    if (haveSequence && r[3] != expected) {
+      uint8_t gap = r[3] - expected;
+      dropped += gap;
+      printf("%14s  --- %u records dropped\n", "", gap);
+    }
+    expected = r[3] + 1;
+    haveSequence = true;
+    printRecord(r);
+    records++;
+    pos += TelemetryRecordBytes;
+  }
+  skipped += data.size() - pos;
+  printf("%lu records, %lu dropped, %lu starts, %lu bytes skipped, %lu resyncs\n",
+         records, dropped, starts, skipped, resyncs);
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*
+  edge_script - drive the real DCF77 decoder and Fidelio display driver
+  on the host from a scripted edge sequence.
+
+  Input (file argument or stdin), one edge per line:
+      <time in ms> <level 0|1>
+  Lines starting with '#' are ignored. Every time the decoder accepts a
+  frame the UTC time is printed, written to the display and the resulting
+  SPI traffic is dumped.
+*/
+
+#include <Arduino.h>
+#include <SimHAL.h>
+#include <stdio.h>
+#include "DCF77.h"
+#include "Time.h"
+#include "fidelio_display.h"
+
+#define DCF_PIN 2
+#define DCF_INTERRUPT 0
+
+int main(int argc, char **argv)
+{
+  FILE *in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "r");
+    if (!in) {
+      fprintf(stderr, "cannot open %s\n", argv[1]);
+      return 1;
+    }
+  }
+
+  Sim::reset();
+  DCF77 DCF(DCF_PIN, DCF_INTERRUPT);
+  FidelioDisplay display(13, 14, 10, 250000UL);
+  DCF.Start();
+  display.init();
+  Sim::clearSpiLog();
+
+  char line[64];
+  unsigned long edges = 0, frames = 0;
+  while (fgets(line, sizeof(line), in)) {
+    unsigned long long ms;
+    int level;
+    if (line[0] == '#' || sscanf(line, "%llu %d", &ms, &level) != 2) continue;
+    Sim::advanceToMicros(ms * 1000);
+    Sim::setPin(DCF_PIN, level);
+    edges++;
+
+    time_t t = DCF.getUTCTime();
+    if (t == 0) continue;
+    frames++;
+    tmElements_t tm;
+    breakTime(t, tm);
+    printf("%10llu ms  UTC %04d-%02d-%02d %02d:%02d:%02d\n", ms,
+           tmYearToCalendar(tm.Year), tm.Month, tm.Day, tm.Hour, tm.Minute, tm.Second);
+
+    char txt[5] = {char('0' + tm.Hour / 10), char('0' + tm.Hour % 10),
+                   char('0' + tm.Minute / 10), char('0' + tm.Minute % 10), 0};
+    display.write(txt);
+    for (size_t i = 0; i < Sim::spiLog().size(); i++) {
+      printf("    spi:");
+      const Sim::SPITransaction &tr = Sim::spiLog()[i];
+      for (size_t j = 0; j < tr.size(); j++) printf(" %02X", tr[j]);
+      printf("\n");
+    }
+    Sim::clearSpiLog();
+  }
+  printf("%lu edges, %lu time updates\n", edges, frames);
+  if (in != stdin) fclose(in);
+  return 0;
+}
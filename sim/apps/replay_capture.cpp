@@ -0,0 +1,110 @@
+/*
+  replay_capture - push a raw edge capture (see lib/DCF77/utility/Capture.h)
+  back through the unmodified DCF77 decoder.
+
+  Usage: replay_capture [--edges] capture.dcfe
+
+  Bytes before the first header (e.g. serial monitor banners) are skipped.
+  A new header (the firmware restarted capture in DCF77::Start()) re-anchors
+  the time line. Every accepted time update is printed with the capture
+  time at which it happened, so two decoder versions can be compared by
+  diffing their output. --edges prints the edges in edge_script format
+  instead of decoding them.
+*/
+
+#include <Arduino.h>
+#include <SimHAL.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "DCF77.h"
+#include "Time.h"
+#include "Capture.h"
+
+#define DCF_PIN 2
+#define DCF_INTERRUPT 0
+
+static bool isHeader(const std::vector<uint8_t> &data, size_t pos)
+{
+  return pos + CAPTURE_HEADER_SIZE <= data.size() &&
+         memcmp(&data[pos], captureMagic, sizeof(captureMagic)) == 0 &&
+         data[pos + 4] == CAPTURE_VERSION;
+}
+
+int main(int argc, char **argv)
+{
+  bool dumpEdges = false;
+  const char *path = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--edges")) dumpEdges = true;
+    else path = argv[i];
+  }
+  if (!path) {
+    fprintf(stderr, "usage: %s [--edges] capture.dcfe\n", argv[0]);
+    return 1;
+  }
+  FILE *in = fopen(path, "rb");
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 1;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) data.insert(data.end(), buf, buf + n);
+  fclose(in);
+
+  size_t pos = 0;
+  while (pos < data.size() && !isHeader(data, pos)) pos++;
+  if (pos == data.size()) {
+    fprintf(stderr, "no capture header found\n");
+    return 1;
+  }
+
+  Sim::reset();
+  Sim::setSerialOutput(NULL);
+  DCF77 DCF(DCF_PIN, DCF_INTERRUPT);
+  DCF.Start();
+
+  uint64_t ms = 0;
+  unsigned long edges = 0, fillers = 0, headers = 0, updates = 0;
+  while (pos + 2 <= data.size()) {
+    if (isHeader(data, pos)) {
+      uint32_t start = data[pos + 5] | (data[pos + 6] << 8) | (data[pos + 7] << 16) |
+                       (uint32_t(data[pos + 8]) << 24);
+      // Restarted captures continue on the same time line
+      if (headers == 0 || start > ms) ms = start;
+      headers++;
+      pos += CAPTURE_HEADER_SIZE;
+      continue;
+    }
+    uint16_t rec = data[pos] | (data[pos + 1] << 8);
+    pos += 2;
+    ms += rec & CAPTURE_DELTA_MASK;
+    if (rec == CAPTURE_OVERFLOW) {
+      fillers++;
+      continue;
+    }
+    uint8_t level = (rec & CAPTURE_LEVEL_BIT) ? HIGH : LOW;
+    edges++;
+    if (dumpEdges) {
+      printf("%llu %d\n", (unsigned long long)ms, level);
+      continue;
+    }
+
+    Sim::advanceToMicros(ms * 1000);
+    Sim::setPin(DCF_PIN, level);
+    time_t t = DCF.getUTCTime();
+    if (t == 0) continue;
+    updates++;
+    tmElements_t tm;
+    breakTime(t, tm);
+    printf("%10llu ms  UTC %04d-%02d-%02d %02d:%02d:%02d\n", (unsigned long long)ms,
+           tmYearToCalendar(tm.Year), tm.Month, tm.Day, tm.Hour, tm.Minute, tm.Second);
+  }
+  if (!dumpEdges) {
+    printf("%lu edges, %lu gap fillers, %lu headers, %lu time updates over %.1f min\n",
+           edges, fillers, headers, updates, ms / 60000.0);
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+#include "DCF77Signal.h"
+
+#include <algorithm>
+
+namespace {
+
+  uint8_t bcd(int value)
+  {
+    return uint8_t(((value / 10) << 4) | (value % 10));
+  }
+
+  // Write count bits of value at position pos and return their parity
+  int putBits(uint64_t &frame, int pos, int count, uint32_t value)
+  {
+    int parity = 0;
+    for (int i = 0; i < count; i++) {
+      uint64_t bit = (value >> i) & 1;
+      frame |= bit << (pos + i);
+      parity ^= int(bit);
+    }
+    return parity;
+  }
+
+  // Last Sunday of the month at 01:00 UTC (EU summer time switch)
+  time_t lastSunday(int year, int month)
+  {
+    struct tm t = {};
+    t.tm_year = year - 1900;
+    t.tm_mon  = month;       // first day of the next month ...
+    t.tm_mday = 1;
+    t.tm_hour = 1;
+    time_t first = timegm(&t);
+    struct tm b;
+    gmtime_r(&first, &b);
+    int back = b.tm_wday == 0 ? 7 : b.tm_wday;
+    return first - back * 86400;   // ... minus days back to the Sunday before
+  }
+}
+
+DCF77Signal::DCF77Signal(const SignalOptions &options)
+  : options(options), rng(options.seed ? options.seed : 1)
+{
+}
+
+time_t DCF77Signal::toCET(time_t utc, bool *summerTime)
+{
+  struct tm b;
+  gmtime_r(&utc, &b);
+  int year = b.tm_year + 1900;
+  bool dst = utc >= lastSunday(year, 3) && utc < lastSunday(year, 10);
+  if (summerTime) *summerTime = dst;
+  return utc + (dst ? 7200 : 3600);
+}
+
+uint64_t DCF77Signal::encodeFrame(time_t minuteStartUTC, time_t leapSecondUTC)
+{
+  bool dst;
+  time_t local = toCET(minuteStartUTC, &dst);
+  bool dstNextHour;
+  toCET(minuteStartUTC + 3600, &dstNextHour);
+  struct tm b;
+  gmtime_r(&local, &b);
+
+  uint64_t frame = 0;
+  putBits(frame, 16, 1, dst != dstNextHour);            // A1: change announced
+  putBits(frame, 17, 1, dst);                           // CEST
+  putBits(frame, 18, 1, !dst);                          // CET
+  putBits(frame, 19, 1, leapSecondUTC && minuteStartUTC > leapSecondUTC - 3600 &&
+                        minuteStartUTC <= leapSecondUTC);   // A2: leap second announced
+  putBits(frame, 20, 1, 1);                             // start of time
+  int p1 = putBits(frame, 21, 7, bcd(b.tm_min));
+  putBits(frame, 28, 1, p1);
+  int p2 = putBits(frame, 29, 6, bcd(b.tm_hour));
+  putBits(frame, 35, 1, p2);
+  int p3 = putBits(frame, 36, 6, bcd(b.tm_mday));
+  p3 ^= putBits(frame, 42, 3, b.tm_wday == 0 ? 7 : b.tm_wday);
+  p3 ^= putBits(frame, 45, 5, bcd(b.tm_mon + 1));
+  p3 ^= putBits(frame, 50, 8, bcd(b.tm_year % 100));
+  putBits(frame, 58, 1, p3);
+  // Bit 59 of the leap second minute is always 0
+  return frame;
+}
+
+unsigned DCF77Signal::appendMinute(time_t minuteStartUTC, uint64_t startUs, std::vector<SignalEdge> &edges)
+{
+  size_t first = edges.size();
+  uint64_t frame = encodeFrame(minuteStartUTC + 60, options.leapSecondUTC);
+  unsigned seconds = minuteStartUTC + 60 == options.leapSecondUTC ? 61 : 60;
+
+  for (int second = 0; second < int(seconds) - 1; second++) {
+    uint64_t secondUs = startUs + uint64_t(second) * 1000000;
+    if (uniform() >= options.dropoutRate) {
+      bool bit = (frame >> second) & 1;
+      if (uniform() < options.bitErrorRate) bit = !bit;
+      pulse(secondUs, bit ? options.longPulseMs : options.shortPulseMs, edges);
+    }
+  }
+  for (int second = 0; second < int(seconds); second++) {
+    if (uniform() < options.spikeRate) {
+      // Spikes land in the gap between the pulse and the next second
+      unsigned offsetMs = 300 + unsigned(uniform() * 600);
+      unsigned widthMs = 1 + unsigned(uniform() * options.spikeMaxMs);
+      uint64_t spikeUs = startUs + uint64_t(second) * 1000000 + offsetMs * 1000ULL;
+      edges.push_back(SignalEdge{spikeUs, 1});
+      edges.push_back(SignalEdge{spikeUs + widthMs * 1000ULL, 0});
+    }
+  }
+
+  std::stable_sort(edges.begin() + first, edges.end(),
+                   [](const SignalEdge &a, const SignalEdge &b) { return a.us < b.us; });
+  if (options.inverted) {
+    for (size_t i = first; i < edges.size(); i++) edges[i].level ^= 1;
+  }
+  return seconds;
+}
+
+void DCF77Signal::pulse(uint64_t startUs, unsigned widthMs, std::vector<SignalEdge> &edges)
+{
+  int64_t rise = int64_t(startUs) + jitter() * 1000LL;
+  int64_t fall = int64_t(startUs) + (int64_t(widthMs) + jitter()) * 1000LL;
+  if (rise < 0) rise = 0;
+  if (fall <= rise) fall = rise + 1000;
+  edges.push_back(SignalEdge{uint64_t(rise), 1});
+  edges.push_back(SignalEdge{uint64_t(fall), 0});
+}
+
+double DCF77Signal::uniform()
+{
+  // xorshift64*
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return double((rng * 2685821657736338717ULL) >> 11) / double(1ULL << 53);
+}
+
+int DCF77Signal::jitter()
+{
+  if (options.jitterMs == 0) return 0;
+  return int(uniform() * (2 * options.jitterMs + 1)) - int(options.jitterMs);
+}
@@ -0,0 +1,75 @@
+#ifndef SIM_DCF77SIGNAL_h
+#define SIM_DCF77SIGNAL_h
+
+/*
+  Synthetic DCF77 receiver output.
+
+  Encodes minute frames with the same bit layout the decoder expects in
+  DCF77Buffer (bit 0 first, 100/200 ms pulses, no pulse in second 59,
+  CEST/CET in bits 17/18, BCD time and date with even parity, optionally
+  a leap second: A2 in bit 19 for the hour before it and a 0 bit 59 in
+  the 61 second minute that inserts it) and turns
+  them into the edge sequence a receiver module would produce. Receiver
+  imperfections can be added on top: edge jitter, dropped pulses, short
+  spurious spikes and misread bits. Everything is driven by a seeded PRNG
+  so runs are reproducible.
+*/
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+struct SignalEdge {
+  uint64_t us;      // virtual time of the edge
+  uint8_t  level;   // pin level after the edge
+};
+
+struct SignalOptions {
+  SignalOptions()
+    : shortPulseMs(100), longPulseMs(200), jitterMs(0), dropoutRate(0),
+      spikeRate(0), spikeMaxMs(30), bitErrorRate(0), inverted(false), seed(1),
+      leapSecondUTC(0) {}
+  unsigned shortPulseMs;   // width of a 0 bit
+  unsigned longPulseMs;    // width of a 1 bit
+  unsigned jitterMs;       // each edge moves uniformly within +-jitterMs
+  double   dropoutRate;    // probability that a second's pulse is missing
+  double   spikeRate;      // probability of a spurious spike per second
+  unsigned spikeMaxMs;     // spikes are 1..spikeMaxMs wide
+  double   bitErrorRate;   // probability that a pulse has the wrong width
+  bool     inverted;       // receiver with active-low output
+  uint32_t seed;
+  time_t   leapSecondUTC;  // a leap second is inserted before this UTC hour, 0 none
+};
+
+class DCF77Signal
+{
+public:
+  explicit DCF77Signal(const SignalOptions &options = SignalOptions());
+
+  // Bits 0..58 of the frame transmitted during the minute before
+  // minuteStartUTC, i.e. the frame announcing minuteStartUTC; with bit 59
+  // when the leap second is inserted before minuteStartUTC
+  static uint64_t encodeFrame(time_t minuteStartUTC, time_t leapSecondUTC = 0);
+  // Central European local time and DST flag for a UTC instant
+  static time_t toCET(time_t utc, bool *summerTime = 0);
+
+  // Append the edges of the minute that starts at minuteStartUTC. The
+  // pulses carry the frame for the following minute; the minute marker
+  // (missing pulse) is second 59, or 60 in a leap second minute. startUs
+  // is the virtual time of the minute start. Returns the length of the
+  // minute in seconds, 60 or 61.
+  unsigned appendMinute(time_t minuteStartUTC, uint64_t startUs, std::vector<SignalEdge> &edges);
+
+  // Idle level of the receiver output
+  uint8_t idleLevel() const { return options.inverted ? 1 : 0; }
+
+private:
+  double   uniform();
+  int      jitter();
+  void     pulse(uint64_t startUs, unsigned widthMs, std::vector<SignalEdge> &edges);
+
+  SignalOptions options;
+  uint64_t      rng;
+};
+
+#endif
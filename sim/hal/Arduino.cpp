@@ -0,0 +1,322 @@
+#include "Arduino.h"
+#include "SimHAL.h"
+
+#include <deque>
+
+uint8_t SREG = 0x80;
+HardwareSerial Serial;
+
+namespace {
+
+  const uint8_t numInterrupts = 2;
+  const uint8_t interruptPins[numInterrupts] = {2, 3};
+
+  uint64_t      simMicros = 0;
+  long          oscillatorPpm = 0;
+  uint8_t       pinLevels[NUM_PINS];
+  uint8_t       pinModes[NUM_PINS];
+  int           analogLevels[NUM_PINS];
+  void        (*isr[numInterrupts])(void);
+  int           isrMode[numInterrupts];
+  void        (*pinChange[NUM_PINS])(void);
+  bool          inIsr = false;
+
+  void        (*timerHandler)(void);
+  uint32_t      timerPeriod;
+  uint64_t      timerNext;
+
+  FILE                *serialOut = stdout;
+  std::deque<uint8_t>  serialIn;
+
+  // Like the AVR, run the handler with interrupts disabled
+  void runIsr(void (*handler)(void))
+  {
+    uint8_t sreg = SREG;
+    SREG &= ~0x80;
+    inIsr = true;
+    handler();
+    inIsr = false;
+    SREG = sreg;
+  }
+
+  void dispatchInterrupt(uint8_t num, uint8_t before, uint8_t after)
+  {
+    if (isr[num] == 0 || !(SREG & 0x80) || inIsr) return;
+    bool fire = (isrMode[num] == CHANGE) ||
+                (isrMode[num] == RISING  && after == HIGH && before == LOW) ||
+                (isrMode[num] == FALLING && after == LOW  && before == HIGH);
+    if (!fire) return;
+    runIsr(isr[num]);
+  }
+
+  // Move virtual time forward, running the timer interrupt on its way
+  void advanceTo(uint64_t target)
+  {
+    while (timerHandler && timerNext <= target) {
+      if (timerNext > simMicros) simMicros = timerNext;
+      timerNext += timerPeriod;
+      if ((SREG & 0x80) && !inIsr) runIsr(timerHandler);
+    }
+    if (target > simMicros) simMicros = target;
+  }
+}
+
+void simResetDS1307(void);
+void simResetSPI(void);
+void simResetSleep(void);
+
+namespace Sim {
+
+  void reset(void)
+  {
+    simMicros = 0;
+    oscillatorPpm = 0;
+    SREG = 0x80;
+    memset(pinLevels, LOW, sizeof(pinLevels));
+    memset(pinModes, INPUT, sizeof(pinModes));
+    memset(analogLevels, 0, sizeof(analogLevels));
+    for (uint8_t i = 0; i < numInterrupts; i++) {
+      isr[i] = 0;
+      isrMode[i] = 0;
+    }
+    memset(pinChange, 0, sizeof(pinChange));
+    timerHandler = 0;
+    serialOut = stdout;
+    serialIn.clear();
+    simResetDS1307();
+    simResetSPI();
+    simResetSleep();
+  }
+
+  uint64_t micros64(void)              { return simMicros; }
+  void     advanceMicros(uint64_t us)  { advanceTo(simMicros + us); }
+  void     advanceMillis(uint64_t ms)  { advanceTo(simMicros + ms * 1000); }
+  void     advanceToMicros(uint64_t us){ advanceTo(us); }
+
+  void setOscillatorPpm(long ppm)
+  {
+    oscillatorPpm = ppm;
+  }
+
+  void attachTimer(uint32_t periodUs, void (*handler)(void))
+  {
+    timerPeriod  = periodUs ? periodUs : 1;
+    timerNext    = simMicros + timerPeriod;
+    timerHandler = handler;
+  }
+
+  void detachTimer(void)
+  {
+    timerHandler = 0;
+  }
+
+  void setPin(uint8_t pin, uint8_t level)
+  {
+    if (pin >= NUM_PINS) return;
+    uint8_t before = pinLevels[pin];
+    pinLevels[pin] = level ? HIGH : LOW;
+    if (before == pinLevels[pin]) return;
+    for (uint8_t i = 0; i < numInterrupts; i++) {
+      if (interruptPins[i] == pin) dispatchInterrupt(i, before, pinLevels[pin]);
+    }
+    if (pinChange[pin] && (SREG & 0x80) && !inIsr) runIsr(pinChange[pin]);
+  }
+
+  void attachPinChange(uint8_t pin, void (*handler)(void))
+  {
+    if (pin < NUM_PINS) pinChange[pin] = handler;
+  }
+
+  void detachPinChange(uint8_t pin)
+  {
+    if (pin < NUM_PINS) pinChange[pin] = 0;
+  }
+
+  void setAnalog(uint8_t pin, int value)
+  {
+    if (pin < NUM_PINS) analogLevels[pin] = value;
+  }
+
+  uint8_t pinLevel(uint8_t pin)
+  {
+    return pin < NUM_PINS ? pinLevels[pin] : LOW;
+  }
+
+  void setSerialOutput(FILE *out)
+  {
+    serialOut = out;
+  }
+
+  void injectSerial(const uint8_t *data, size_t len)
+  {
+    serialIn.insert(serialIn.end(), data, data + len);
+  }
+}
+
+void cli(void) { SREG &= ~0x80; }
+void sei(void) { SREG |= 0x80; }
+
+// What the ATmega counts, with its oscillator error
+static uint64_t cpuMicros(void)
+{
+  return simMicros + (int64_t)simMicros * oscillatorPpm / 1000000;
+}
+
+uint32_t millis(void)
+{
+  return (uint32_t)(cpuMicros() / 1000);
+}
+
+uint32_t micros(void)
+{
+  return (uint32_t)cpuMicros();
+}
+
+// Delays are counted by the ATmega too
+static uint64_t trueMicros(uint64_t us)
+{
+  return us * 1000000 / (1000000 + oscillatorPpm);
+}
+
+void delay(unsigned long ms)
+{
+  advanceTo(simMicros + trueMicros((uint64_t)ms * 1000));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  advanceTo(simMicros + trueMicros(us));
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin >= NUM_PINS) return;
+  pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP) pinLevels[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (pin < NUM_PINS) pinLevels[pin] = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin < NUM_PINS ? pinLevels[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+  return pin < NUM_PINS ? analogLevels[pin] : 0;
+}
+
+void analogWrite(uint8_t pin, int val)
+{
+  if (pin < NUM_PINS) analogLevels[pin] = val;
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+  if (interruptNum >= numInterrupts) return;
+  isr[interruptNum] = userFunc;
+  isrMode[interruptNum] = mode;
+}
+
+void detachInterrupt(uint8_t interruptNum)
+{
+  if (interruptNum >= numInterrupts) return;
+  isr[interruptNum] = 0;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/**
+ * Print
+ */
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+size_t Print::print(const char *s)
+{
+  return write(s);
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t Print::print(long n, int base)
+{
+  if (base == DEC && n < 0) {
+    size_t t = print('-');
+    return t + print((unsigned long)-n, base);
+  }
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+size_t Print::print(double n, int digits)
+{
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+/**
+ * Serial
+ */
+int HardwareSerial::available()
+{
+  return (int)serialIn.size();
+}
+
+int HardwareSerial::read()
+{
+  if (serialIn.empty()) return -1;
+  int c = serialIn.front();
+  serialIn.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek()
+{
+  return serialIn.empty() ? -1 : serialIn.front();
+}
+
+int HardwareSerial::availableForWrite()
+{
+  return 63;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (serialOut) fputc(c, serialOut);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  if (serialOut) fwrite(buffer, 1, size, serialOut);
+  return size;
+}
@@ -0,0 +1,143 @@
+#ifndef SIM_ARDUINO_h
+#define SIM_ARDUINO_h
+
+/*
+  Host stand-in for the Arduino core.
+
+  Only the part of the API that the clock firmware and its libraries use is
+  provided. Time is virtual: millis()/micros() only move when the simulation
+  (or delay()) advances them, so scripted edge sequences replay
+  deterministically and as fast as the host can run them.
+  See SimHAL.h for the controls that drive pins, time and the DS1307.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cstdlib>
+#include <avr/pgmspace.h>
+
+using std::abs;
+
+typedef uint8_t  byte;
+typedef uint16_t word;
+typedef bool     boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define NOT_AN_INTERRUPT -1
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+#define NUM_PINS 22
+
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+
+// AVR status register and global interrupt flag
+extern uint8_t SREG;
+void cli(void);
+void sei(void);
+#define interrupts()   sei()
+#define noInterrupts() cli()
+
+// 32 bits wide like on the AVR, so wrap-around arithmetic in the firmware
+// and its libraries behaves the same on the host
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
+void detachInterrupt(uint8_t interruptNum);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+// The host has a single address space: strings in "flash" are plain strings
+#define F(s) (s)
+
+class __FlashStringHelper;
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+  size_t print(const char *s);
+  size_t print(const __FlashStringHelper *s) { return print((const char *)s); }
+  size_t print(char c);
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(long long n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned long long n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(double n, int digits = 2);
+
+  size_t println(void) { return print("\r\n"); }
+  template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(T v, int f) { size_t n = print(v, f); return n + println(); }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+  int available();
+  int read();
+  int peek();
+  int availableForWrite();
+  void flush() {}
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
+  operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,131 @@
+#include "RTClib.h"
+#include "SimHAL.h"
+
+namespace {
+
+  const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  const uint32_t SECONDS_FROM_1970_TO_2000 = 946684800UL;
+
+  uint16_t date2days(uint16_t y, uint8_t m, uint8_t d)
+  {
+    if (y >= 2000U) y -= 2000U;
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i) days += daysInMonth[i - 1];
+    if (m > 2 && y % 4 == 0) ++days;
+    return days + 365 * y + (y + 3) / 4 - 1;
+  }
+
+  uint8_t bcd2bin(uint8_t val) { return val - 6 * (val >> 4); }
+  uint8_t bin2bcd(uint8_t val) { return val + 6 * (val / 10); }
+}
+
+DateTime::DateTime(uint32_t t)
+{
+  t -= SECONDS_FROM_1970_TO_2000;
+  ss = t % 60;
+  t /= 60;
+  mm = t % 60;
+  t /= 60;
+  hh = t % 24;
+  uint16_t days = t / 24;
+  uint8_t leap;
+  for (yOff = 0;; ++yOff) {
+    leap = yOff % 4 == 0;
+    if (days < 365U + leap) break;
+    days -= 365 + leap;
+  }
+  for (m = 1; m < 12; ++m) {
+    uint8_t daysPerMonth = daysInMonth[m - 1];
+    if (leap && m == 2) ++daysPerMonth;
+    if (days < daysPerMonth) break;
+    days -= daysPerMonth;
+  }
+  d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day,
+                   uint8_t hour, uint8_t min, uint8_t sec)
+{
+  if (year >= 2000U) year -= 2000U;
+  yOff = year;
+  m = month;
+  d = day;
+  hh = hour;
+  mm = min;
+  ss = sec;
+}
+
+uint8_t DateTime::dayOfTheWeek() const
+{
+  uint16_t day = date2days(yOff, m, d);
+  return (day + 6) % 7; // Jan 1, 2000 is a Saturday, i.e. returns 6
+}
+
+uint32_t DateTime::unixtime(void) const
+{
+  uint16_t days = date2days(yOff, m, d);
+  return ((days * 24UL + hh) * 60 + mm) * 60 + ss + SECONDS_FROM_1970_TO_2000;
+}
+
+void RTC_DS1307::adjust(const DateTime &dt)
+{
+  uint8_t regs[7];
+  regs[0] = bin2bcd(dt.second());
+  regs[1] = bin2bcd(dt.minute());
+  regs[2] = bin2bcd(dt.hour());
+  regs[3] = bin2bcd(0);
+  regs[4] = bin2bcd(dt.day());
+  regs[5] = bin2bcd(dt.month());
+  regs[6] = bin2bcd(dt.year() - 2000U);
+  Sim::ds1307Write(0, regs, 7);
+}
+
+uint8_t RTC_DS1307::isrunning(void)
+{
+  uint8_t ss;
+  Sim::ds1307Read(0, &ss, 1);
+  return !(ss >> 7);
+}
+
+DateTime RTC_DS1307::now()
+{
+  uint8_t regs[7];
+  Sim::ds1307Read(0, regs, 7);
+  return DateTime(bcd2bin(regs[6]) + 2000U, bcd2bin(regs[5]), bcd2bin(regs[4]),
+                  bcd2bin(regs[2]), bcd2bin(regs[1]), bcd2bin(regs[0] & 0x7F));
+}
+
+Ds1307SqwPinMode RTC_DS1307::readSqwPinMode()
+{
+  uint8_t mode;
+  Sim::ds1307Read(0x07, &mode, 1);
+  return (Ds1307SqwPinMode)(mode & 0x93);
+}
+
+void RTC_DS1307::writeSqwPinMode(Ds1307SqwPinMode mode)
+{
+  uint8_t control = mode;
+  Sim::ds1307Write(0x07, &control, 1);
+}
+
+uint8_t RTC_DS1307::readnvram(uint8_t address)
+{
+  uint8_t data;
+  readnvram(&data, 1, address);
+  return data;
+}
+
+void RTC_DS1307::readnvram(uint8_t *buf, uint8_t size, uint8_t address)
+{
+  Sim::ds1307Read(address + 0x08, buf, size);
+}
+
+void RTC_DS1307::writenvram(uint8_t address, uint8_t data)
+{
+  writenvram(address, &data, 1);
+}
+
+void RTC_DS1307::writenvram(uint8_t address, const uint8_t *buf, uint8_t size)
+{
+  Sim::ds1307Write(address + 0x08, buf, size);
+}
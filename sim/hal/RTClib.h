@@ -0,0 +1,58 @@
+#ifndef SIM_RTCLIB_h
+#define SIM_RTCLIB_h
+
+/*
+  Host stand-in for the subset of Adafruit RTClib used by the clock:
+  DateTime and RTC_DS1307. The DS1307 is modelled at register level
+  (see SimDS1307.cpp) so clock registers and the 56 bytes of NVRAM behave
+  like the real chip, including the CH (clock halt) bit.
+*/
+
+#include <Arduino.h>
+
+class DateTime
+{
+public:
+  DateTime(uint32_t t = 946684800UL);
+  DateTime(uint16_t year, uint8_t month, uint8_t day,
+           uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+
+  uint16_t year() const       { return 2000U + yOff; }
+  uint8_t  month() const      { return m; }
+  uint8_t  day() const        { return d; }
+  uint8_t  hour() const       { return hh; }
+  uint8_t  minute() const     { return mm; }
+  uint8_t  second() const     { return ss; }
+  uint8_t  dayOfTheWeek() const;
+  uint32_t unixtime(void) const;
+
+protected:
+  uint8_t yOff, m, d, hh, mm, ss;
+};
+
+// Control register (0x07) values for the SQW/OUT pin
+enum Ds1307SqwPinMode {
+  DS1307_OFF = 0x00,
+  DS1307_ON = 0x80,
+  DS1307_SquareWave1HZ = 0x10,
+  DS1307_SquareWave4kHz = 0x11,
+  DS1307_SquareWave8kHz = 0x12,
+  DS1307_SquareWave32kHz = 0x13
+};
+
+class RTC_DS1307
+{
+public:
+  bool begin(void) { return true; }
+  void adjust(const DateTime &dt);
+  uint8_t isrunning(void);
+  DateTime now();
+  Ds1307SqwPinMode readSqwPinMode();
+  void writeSqwPinMode(Ds1307SqwPinMode mode);
+  uint8_t readnvram(uint8_t address);
+  void readnvram(uint8_t *buf, uint8_t size, uint8_t address);
+  void writenvram(uint8_t address, uint8_t data);
+  void writenvram(uint8_t address, const uint8_t *buf, uint8_t size);
+};
+
+#endif
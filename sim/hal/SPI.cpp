@@ -0,0 +1,79 @@
+#include "SPI.h"
+#include "SimHAL.h"
+
+SPIClass SPI;
+
+namespace {
+  std::vector<Sim::SPITransaction> transactions;
+  Sim::SPITransaction              current;
+  bool                             logging = true;
+  bool                             inTransaction = false;
+  uint32_t                         clock = 4000000;
+  unsigned long                    byteCount = 0;
+}
+
+void simResetSPI(void)
+{
+  transactions.clear();
+  current.clear();
+  logging = true;
+  inTransaction = false;
+  clock = 4000000;
+  byteCount = 0;
+}
+
+namespace Sim {
+
+  const std::vector<SPITransaction> &spiLog(void)
+  {
+    return transactions;
+  }
+
+  void clearSpiLog(void)
+  {
+    transactions.clear();
+    byteCount = 0;
+  }
+
+  void setSpiLogging(bool enabled)
+  {
+    logging = enabled;
+  }
+
+  unsigned long spiBytes(void)
+  {
+    return byteCount;
+  }
+}
+
+void SPIClass::begin() {}
+void SPIClass::end() {}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+  clock = settings.clock ? settings.clock : 4000000;
+  current.clear();
+  inTransaction = true;
+}
+
+void SPIClass::endTransaction()
+{
+  if (logging) transactions.push_back(current);
+  inTransaction = false;
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  byteCount++;
+  if (logging && inTransaction) current.push_back(data);
+  // Account for the bus time of 8 bits at the transaction's clock
+  Sim::advanceMicros(8000000UL / clock);
+  return 0;
+}
+
+uint16_t SPIClass::transfer16(uint16_t data)
+{
+  transfer(uint8_t(data >> 8));
+  transfer(uint8_t(data & 0xFF));
+  return 0;
+}
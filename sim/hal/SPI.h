@@ -0,0 +1,41 @@
+#ifndef SIM_SPI_h
+#define SIM_SPI_h
+
+/*
+  Host stand-in for the Arduino SPI library. Nothing is clocked out;
+  every transaction is recorded so the harness can check what a driver
+  sent (see Sim::spiLog()).
+*/
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings
+{
+public:
+  SPISettings() : clock(4000000), bitOrder(MSBFIRST), dataMode(SPI_MODE0) {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+    : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+  uint32_t clock;
+  uint8_t  bitOrder;
+  uint8_t  dataMode;
+};
+
+class SPIClass
+{
+public:
+  void begin();
+  void end();
+  void beginTransaction(SPISettings settings);
+  void endTransaction();
+  uint8_t transfer(uint8_t data);
+  uint16_t transfer16(uint16_t data);
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,150 @@
+#include "Arduino.h"
+#include "SimHAL.h"
+
+/*
+  Register-level DS1307 model. The clock is kept as a unix time anchored
+  to a point in virtual time; registers 0x00-0x06 are derived from it on
+  read and re-anchor it on write, which (like the real chip) restarts the
+  one second countdown.
+*/
+
+namespace {
+
+  const uint8_t  regCount = 0x40;
+  // One byte on the 100 kHz I2C bus: 8 bits and the acknowledge
+  const uint32_t byteMicros = 90;
+
+  uint8_t        nvram[regCount];
+  bool           running = false;
+  uint32_t       epoch = 0;          // unix time at anchor
+  uint64_t       anchorMicros = 0;   // virtual time of anchor
+  long           driftPpm = 0;
+  unsigned long  transactions = 0;
+
+  uint8_t bin2bcd(uint8_t val) { return val + 6 * (val / 10); }
+  uint8_t bcd2bin(uint8_t val) { return val - 6 * (val >> 4); }
+
+  const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+  bool isLeap(uint16_t y) { return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0; }
+
+  uint32_t currentTime(void)
+  {
+    if (!running) return epoch;
+    int64_t elapsed = (int64_t)(Sim::micros64() - anchorMicros);
+    elapsed += elapsed * driftPpm / 1000000;
+    return epoch + (uint32_t)(elapsed / 1000000);
+  }
+
+  void toRegisters(uint32_t t, uint8_t *regs)
+  {
+    regs[0] = bin2bcd(t % 60) | (running ? 0 : 0x80);
+    t /= 60;
+    regs[1] = bin2bcd(t % 60);
+    t /= 60;
+    regs[2] = bin2bcd(t % 24);
+    uint32_t days = t / 24;
+    regs[3] = bin2bcd((days + 4) % 7 + 1);
+    uint16_t y = 1970;
+    while (days >= (isLeap(y) ? 366U : 365U)) {
+      days -= isLeap(y) ? 366 : 365;
+      y++;
+    }
+    uint8_t m = 0;
+    for (; m < 11; m++) {
+      uint8_t len = daysInMonth[m] + (m == 1 && isLeap(y));
+      if (days < len) break;
+      days -= len;
+    }
+    regs[4] = bin2bcd(days + 1);
+    regs[5] = bin2bcd(m + 1);
+    regs[6] = bin2bcd(y % 100);
+  }
+
+  uint32_t fromRegisters(const uint8_t *regs)
+  {
+    uint16_t y = 2000 + bcd2bin(regs[6]);
+    uint8_t  m = bcd2bin(regs[5]);
+    uint32_t days = 0;
+    for (uint16_t i = 1970; i < y; i++) days += isLeap(i) ? 366 : 365;
+    for (uint8_t i = 1; i < m; i++) days += daysInMonth[i - 1] + (i == 2 && isLeap(y));
+    days += bcd2bin(regs[4]) - 1;
+    return ((days * 24 + bcd2bin(regs[2] & 0x3F)) * 60 + bcd2bin(regs[1])) * 60
+           + bcd2bin(regs[0] & 0x7F);
+  }
+}
+
+void simResetDS1307(void)
+{
+  memset(nvram, 0, sizeof(nvram));
+  running = false;
+  epoch = 0;
+  anchorMicros = 0;
+  driftPpm = 0;
+  transactions = 0;
+}
+
+namespace Sim {
+
+  void rtcSet(uint32_t unixtime)
+  {
+    epoch = unixtime;
+    anchorMicros = micros64();
+    running = true;
+  }
+
+  void rtcSetDrift(long ppm)
+  {
+    epoch = currentTime();
+    anchorMicros = micros64();
+    driftPpm = ppm;
+  }
+
+  void rtcHalt(void)
+  {
+    epoch = currentTime();
+    running = false;
+  }
+
+  // Transfers take their bus time: address and register pointer, then
+  // address and data for a read
+  void ds1307Read(uint8_t reg, uint8_t *buf, uint8_t len)
+  {
+    transactions++;
+    uint8_t clock[7];
+    toRegisters(currentTime(), clock);
+    for (uint8_t i = 0; i < len; i++) {
+      uint8_t r = (reg + i) % regCount;
+      buf[i] = r < 7 ? clock[r] : nvram[r];
+    }
+    advanceMicros((3 + len) * byteMicros);
+  }
+
+  void ds1307Write(uint8_t reg, const uint8_t *buf, uint8_t len)
+  {
+    transactions++;
+    uint8_t clock[7];
+    toRegisters(currentTime(), clock);
+    bool clockWritten = false;
+    for (uint8_t i = 0; i < len; i++) {
+      uint8_t r = (reg + i) % regCount;
+      if (r < 7) {
+        clock[r] = buf[i];
+        clockWritten = true;
+      } else {
+        nvram[r] = buf[i];
+      }
+    }
+    if (clockWritten) {
+      running = !(clock[0] & 0x80);
+      epoch = fromRegisters(clock);
+      anchorMicros = micros64();
+    }
+    advanceMicros((2 + len) * byteMicros);
+  }
+
+  unsigned long ds1307Transactions(void)
+  {
+    return transactions;
+  }
+}
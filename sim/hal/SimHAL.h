@@ -0,0 +1,74 @@
+#ifndef SIM_HAL_h
+#define SIM_HAL_h
+
+/*
+  Controls for the host-side hardware simulation.
+
+  The firmware only ever sees the Arduino API from Arduino.h, SPI.h and
+  RTClib.h; the harness uses the functions below to move virtual time,
+  toggle input pins (firing attached interrupts exactly like the AVR
+  external interrupt unit would) and inspect what went out on SPI and
+  Serial.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+namespace Sim {
+
+  // Reset time, pins, interrupts, serial and SPI logs and the DS1307
+  void reset(void);
+
+  // Virtual time, in microseconds since reset
+  uint64_t micros64(void);
+  void     advanceMicros(uint64_t us);
+  void     advanceMillis(uint64_t ms);
+  // Advance to an absolute time; never moves backwards
+  void     advanceToMicros(uint64_t us);
+  // Rate error of the ATmega oscillator: millis() and micros() run fast
+  // (positive) or slow against virtual time, which stays the true time
+  void     setOscillatorPpm(long ppm);
+
+  // Periodic timer compare interrupt, the stand-in for an AVR timer in CTC
+  // mode: while time advances the handler runs every periodUs (at exactly
+  // that virtual time) unless interrupts are disabled
+  void attachTimer(uint32_t periodUs, void (*handler)(void));
+  void detachTimer(void);
+
+  // Drive an input pin; fires the attached interrupt on a matching edge
+  void setPin(uint8_t pin, uint8_t level);
+  // Pin change interrupt: the handler runs on every level change of pin,
+  // the stand-in for PCINT on pins without an external interrupt
+  void attachPinChange(uint8_t pin, void (*handler)(void));
+  void detachPinChange(uint8_t pin);
+  void setAnalog(uint8_t pin, int value);
+  uint8_t pinLevel(uint8_t pin);
+
+  // Serial: bytes written by the firmware go to this stream (stdout by
+  // default, NULL discards them); injected bytes are returned by Serial.read()
+  void setSerialOutput(FILE *out);
+  void injectSerial(const uint8_t *data, size_t len);
+
+  // SPI: every beginTransaction()..endTransaction() is logged as one entry
+  typedef std::vector<uint8_t> SPITransaction;
+  const std::vector<SPITransaction> &spiLog(void);
+  void clearSpiLog(void);
+  void setSpiLogging(bool enabled);
+  unsigned long spiBytes(void);
+
+  // DS1307: start the oscillator at the given unix time. ppm lets the
+  // simulated crystal run fast (positive) or slow (negative).
+  void rtcSet(uint32_t unixtime);
+  void rtcSetDrift(long ppm);
+  void rtcHalt(void);
+  // Raw register file access (0x00-0x07 clock/control, 0x08-0x3F NVRAM)
+  void ds1307Read(uint8_t reg, uint8_t *buf, uint8_t len);
+  void ds1307Write(uint8_t reg, const uint8_t *buf, uint8_t len);
+  unsigned long ds1307Transactions(void);
+
+  // Number of times the firmware entered a sleep mode
+  unsigned long sleepCount(void);
+}
+
+#endif
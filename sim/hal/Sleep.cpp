@@ -0,0 +1,39 @@
+#include "Arduino.h"
+#include "SimHAL.h"
+#include "avr/sleep.h"
+
+namespace {
+  unsigned char mode = SLEEP_MODE_IDLE;
+  bool          enabled = false;
+  unsigned long count = 0;
+}
+
+void simResetSleep(void)
+{
+  mode = SLEEP_MODE_IDLE;
+  enabled = false;
+  count = 0;
+}
+
+void set_sleep_mode(unsigned char m) { mode = m; }
+void sleep_enable(void)  { enabled = true; }
+void sleep_disable(void) { enabled = false; }
+
+void sleep_cpu(void)
+{
+  if (enabled) count++;
+}
+
+void sleep_mode(void)
+{
+  sleep_enable();
+  sleep_cpu();
+  sleep_disable();
+}
+
+namespace Sim {
+  unsigned long sleepCount(void)
+  {
+    return count;
+  }
+}
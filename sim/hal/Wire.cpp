@@ -0,0 +1,54 @@
+#include "Wire.h"
+#include "SimHAL.h"
+
+TwoWire Wire;
+
+static const uint8_t ds1307Address = 0x68;
+
+void TwoWire::beginTransmission(uint8_t addr)
+{
+  address = addr;
+  len = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+  if (len == sizeof(buf)) return 0;
+  buf[len++] = data;
+  return 1;
+}
+
+// 0 success, 2 address not acknowledged
+uint8_t TwoWire::endTransmission(bool)
+{
+  if (address != ds1307Address) return 2;
+  if (len == 0) return 0;
+  pointer = buf[0];
+  if (len > 1) {
+    Sim::ds1307Write(pointer, buf + 1, len - 1);
+    pointer += len - 1;
+  }
+  len = pos = 0;
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t quantity)
+{
+  len = pos = 0;
+  if (addr != ds1307Address) return 0;
+  if (quantity > sizeof(buf)) quantity = sizeof(buf);
+  Sim::ds1307Read(pointer, buf, quantity);
+  pointer += quantity;
+  len = quantity;
+  return quantity;
+}
+
+int TwoWire::available(void)
+{
+  return len - pos;
+}
+
+int TwoWire::read(void)
+{
+  return pos < len ? buf[pos++] : -1;
+}
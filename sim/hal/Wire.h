@@ -0,0 +1,34 @@
+#ifndef SIM_WIRE_h
+#define SIM_WIRE_h
+
+/*
+  Host stand-in for the Arduino Wire library with the DS1307 model as the
+  only device on the bus (address 0x68). A transmission that only sets
+  the register pointer is held until the following requestFrom(), so a
+  pointer-then-read pair counts as one DS1307 transaction with the bus
+  time of both halves, like the register access in RTClib.cpp.
+*/
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+  void begin(void) {}
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity);
+  int available(void);
+  int read(void);
+
+private:
+  uint8_t address;
+  uint8_t pointer;
+  uint8_t buf[32];
+  uint8_t len, pos;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef SIM_AVR_PGMSPACE_h
+#define SIM_AVR_PGMSPACE_h
+
+/*
+  Host stand-in for <avr/pgmspace.h>. The host has one address space, so
+  data placed in "flash" is ordinary const data read through a pointer.
+*/
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr)  (*(const void *const *)(addr))
+
+#endif
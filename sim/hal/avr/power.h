@@ -0,0 +1,15 @@
+#ifndef SIM_AVR_POWER_h
+#define SIM_AVR_POWER_h
+
+// Host stand-in for <avr/power.h>; peripherals are never really gated
+
+#define power_all_disable()
+#define power_all_enable()
+#define power_adc_disable()
+#define power_adc_enable()
+#define power_spi_disable()
+#define power_spi_enable()
+#define power_twi_disable()
+#define power_twi_enable()
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SIM_AVR_SLEEP_h
+#define SIM_AVR_SLEEP_h
+
+/*
+  Host stand-in for <avr/sleep.h>. sleep_mode() only counts; the caller's
+  wake-up interrupt is whatever the harness triggers next.
+*/
+
+#define SLEEP_MODE_IDLE       0
+#define SLEEP_MODE_ADC        1
+#define SLEEP_MODE_PWR_DOWN   2
+#define SLEEP_MODE_PWR_SAVE   3
+#define SLEEP_MODE_STANDBY    6
+#define SLEEP_MODE_EXT_STANDBY 7
+
+void set_sleep_mode(unsigned char mode);
+void sleep_enable(void);
+void sleep_disable(void);
+void sleep_cpu(void);
+void sleep_mode(void);
+
+#endif
@@ -1,12 +1,36 @@
 #include <Arduino.h>
 #include <SPI.h> // https://community.platformio.org/t/adafruit-busio-adafruit-spidevice-h17-fatal-error-spi-h-no-such-file-or-directory/14864/9
 #include "DCF77.h"
+#include "DCF77Combiner.h"
 #include "Time.h"
 #include <Timezone.h>
 #include "RTClib.h"
+#include <CpuProfile.h>
+#include <Dispatcher.h>
+#include <RtcWake.h>
+#include <ClockDiscipline.h>
+#include <LocalClock.h>
+#include <SyncState.h>
+#include <Telemetry.h>
 #include <avr/sleep.h>  // Include the AVR sleep library
 #include <avr/power.h>  // Optional, if you want to disable/enable peripherals
 
+// The edge capture stream is binary, keep text output off the wire
+#ifdef DCF_CAPTURE
+#undef VERBOSE_DEBUG
+#ifdef CPU_PROFILE
+#error "DCF_CAPTURE and CPU_PROFILE both use Serial; enable only one"
+#endif
+#endif
+
+// So is the telemetry stream, which replaces the text
+#ifdef TELEMETRY
+#undef VERBOSE_DEBUG
+#ifdef CPU_PROFILE
+#error "TELEMETRY and CPU_PROFILE both use Serial; enable only one"
+#endif
+#endif
+
 // Some debug macros for serial printing :)
 #ifdef VERBOSE_DEBUG
 #define DEBUG(msg) (Serial.print(msg))
@@ -19,6 +43,10 @@
 
 #define DCF_PIN 2	         // Connection pin to DCF 77 device
 #define DCF_INTERRUPT 0		 // Interrupt number associated with pin
+// A second receiver, combined with the first (DCF77Combiner). It needs
+// the other external interrupt, so the PIR sensor must move off pin 3.
+// #define DCF2_PIN 3
+// #define DCF2_INTERRUPT 1
 #define lightPin A0        // photo resistor sensor
 #define keyInput A1        // input from resistors' keyboard
 #define PRESS_TOLERANCE 40
@@ -26,13 +54,52 @@
 #define LED1      5
 #define LED2      6
 #define pirPin    3
+#if defined(DCF2_PIN) && DCF2_PIN == pirPin
+#error "DCF2_PIN and pirPin share a pin; move the PIR sensor"
+#endif
 #define STAYON   180000UL  // 10 min in milliseconds
 #define DELTA    10
 
+// Task periods in milliseconds
+#define SERIAL_PERIOD   20
+#define ANIMATE_PERIOD  10
+#define LIGHT_PERIOD    500
+#define BUTTON_PERIOD   20     // two scans make the PRESSED_TIME debounce
+#define DISPLAY_PERIOD  20     // latency of the display after a new second
+#define TRACK_PERIOD    1      // ClockDiscipline reads the RTC around its second edge
+#define POWER_PERIOD    1000
+#define MINUTE_PERIOD   60000
+
 // based on the powerbank type, disable deep sleep to avoid switching powerbank off due to low current consumption
 const boolean trueSleep = false;  
 
+// Scheduled reception for battery units. The receiver only runs from the
+// listed local hours on until a frame is accepted, at most RX_WINDOW
+// minutes; a second one when that is needed to confirm an announcement.
+// In between the clock runs on the RTC. With the display off the
+// MCU powers down and the DS1307 square wave on sqwPin wakes it once a
+// second. Supersedes trueSleep.
+const boolean scheduledReception = false;
+const byte receptionHours[] = {3, 15};
+#define RX_WINDOW   20         // minutes
+#define RX_GIVE_UP  5          // minutes, then a window closes when DCF.quality()
+#define RX_MIN_QUALITY 10      // is below this: nothing but noise to receive
+#define sqwPin      4          // DS1307 SQW/OUT, pin change interrupt
+// #define dcfPonPin 7         // receiver PON (LOW = on), if it is wired
+
+// Keep-alive for powerbanks that switch off at low load: keepAlivePin
+// drives a load for KEEPALIVE_MS every KEEPALIVE_EVERY seconds, also
+// while powered down. 0 disables it; the dispatcher period is 16 bit ms,
+// so at most 65.
+#define keepAlivePin     8
+#define KEEPALIVE_MS     60
+#define KEEPALIVE_EVERY  0
+#if KEEPALIVE_EVERY > 65
+#error "KEEPALIVE_EVERY does not fit a dispatcher period, at most 65 s"
+#endif
+
 #include "fidelio_display.h"
+#include "fidelio_animator.h"
 
 #ifdef FIDELIODISPLAY_h
 
@@ -42,25 +109,59 @@ const boolean trueSleep = false;
     #define spiClk 250000UL 
 
     FidelioDisplay display(dioPin, clkPin, stbPin, spiClk);
+    FidelioAnimator animator(display);
 
-#endif
+    // Status codes, glyphs looked up at compile time
+    constexpr FidelioDisplay::Glyphs syncText = FidelioDisplay::text("SYnC");
+    constexpr FidelioDisplay::Glyphs errText  = FidelioDisplay::text("Err");
+    constexpr FidelioDisplay::Glyphs rtcText  = FidelioDisplay::text("rtc");
 
-char timetxt[5];
+#endif
 
 // more time zones, see  http://en.wikipedia.org/wiki/Time_zones_of_Europe
 // United Kingdom (London, Belfast)
 // TimeChangeRule rBST = {"BST", Last, Sun, Mar, 1, 60};   //British Summer Time
 // TimeChangeRule rGMT = {"GMT", Last, Sun, Oct, 2, 0};    //Standard Time
-// Timezone UK(rBST, rGMT);
+// LocalClock UK(rBST, rGMT);
 
 TimeChangeRule rCEST = {"CEST", Last, Sun, Mar, 2, 120};   // starts last Sunday in March at 2:00 am, UTC offset +120 minutes; Central European Summer Time (CEST)
 TimeChangeRule rCET =  {"CET", Last, Sun, Oct, 3, 60};     // ends last Sunday in October at 3:00 am, UTC offset +60 minutes; Central European Time (CET)
-Timezone CET(rCEST, rCET);
+LocalClock CET(rCEST, rCET);
+
+// Local time at now(); between minutes that is a subtraction
+const LocalClock &localNow() {
+  CET.update(now());
+  return CET;
+}
 
 
 time_t time;
-DCF77 DCF = DCF77(DCF_PIN,DCF_INTERRUPT);
+#ifdef DCF2_PIN
+  DCF77 DCF1 = DCF77(DCF_PIN,DCF_INTERRUPT);
+  DCF77 DCF2 = DCF77(DCF2_PIN,DCF2_INTERRUPT);
+  DCF77Combiner DCF(DCF1, DCF2);
+#else
+  DCF77 DCF = DCF77(DCF_PIN,DCF_INTERRUPT);
+#endif
 RTC_DS1307 rtc;
+Dispatcher tasks;
+byte frameEvent, motionEvent;   // ids to signal
+
+#ifdef FIDELIODISPLAY_h
+  // Date pages shown on button 1: DD.MM, then the year
+  void showDate(FidelioDisplay &d) {
+    const LocalClock &local = localNow();
+    d.dots(true);
+    d.printTime(local.day(), local.month());
+  }
+
+  void showYear(FidelioDisplay &d) {
+    d.dots(false);
+    d.print(localNow().year());
+  }
+
+  const FidelioAnimator::Page datePages[] = {showDate, showYear};
+#endif
 
 unsigned long getDCFTime()
 { 
@@ -98,51 +199,171 @@ void digitalClockDisplay(){
   #endif
 }
 
-void intToTimeString(char *str, int hour, int minute) {
-    // Ensure hours and minutes are within 0-99
-    hour = hour % 100;
-    minute = minute % 100;
-
-    // Convert each digit to a character and place it in the string
-    str[0] = '0' + hour / 10;
-    str[1] = '0' + hour % 10;
-    str[2] = '0' + minute / 10;
-    str[3] = '0' + minute % 10;
-    str[4] = '\0'; // Null-terminate the string
+// The receiver whose running frame the display shows
+DCF77 &shownReceiver() {
+  #ifdef DCF2_PIN
+    return DCF.best();
+  #else
+    return DCF;
+  #endif
 }
 
+// "SYnC" until the first bit of a minute, then the last bit and the
+// number of bits received so far
 void showSyncProcess(){
   #ifdef FIDELIODISPLAY_h
-    intToTimeString(timetxt, 0, DCF.bufLen());
-    timetxt[0] = '0'+DCF.lastBit;
-    timetxt[1] = ':';
-    display.pm(!DCF.bufOk);
-    display.write(timetxt);
-    // DEBUG_LN(); Serial.print("In sync process: "); DEBUG_LN(timetxt);
+    DCF77 &shown = shownReceiver();
+    display.pm(!shown.bufOk);
+    if (shown.bufLen() == 0) {
+      display.print(syncText);
+      return;
+    }
+    display.at(0, '0' + shown.lastBit);
+    display.at(1, ' ');
+    display.printAt(2, 2, shown.bufLen(), DEC, '0');
   #endif
 }
 
-time_t dateTimeToTime_t(DateTime dt) {
-    tmElements_t tm;
-    tm.Year = dt.year() - 1970;
-    tm.Month = dt.month();
-    tm.Day = dt.day();
-    tm.Hour = dt.hour();
-    tm.Minute = dt.minute();
-    tm.Second = dt.second();
-    return makeTime(tm); // Convert to time_t
+volatile long lastMovementTime;
+void wakeUp() {
+  lastMovementTime = millis();
+  tasks.signal(motionEvent);
 }
 
-DateTime time_tToDateTime(time_t t) {
-    tmElements_t tm;
-    breakTime(t, tm); // Break the time_t into components
-    // Construct and return a DateTime object
-    return DateTime(tm.Year + 1970, tm.Month, tm.Day, tm.Hour, tm.Minute, tm.Second);
+boolean receiving = false;        // receiver and decoder running
+uint32_t receptionStart;
+time_t lastSync = 0;              // UTC of the last accepted frame
+time_t windowClosedAt = 0;        // UTC a reception window was closed without frame
+boolean confirming = false;       // window kept open for a second frame
+
+// How long the clock may go without a frame. Scheduled, that is as long as
+// the fitted DS1307 drift keeps it within DisciplineMaxErrorMs, at least
+// from one day's window to the next.
+uint32_t syncLimit() {
+  if (!scheduledReception) return 180;
+  uint32_t gap = ClockDiscipline::syncGap();
+  return (gap > SECS_PER_DAY ? gap : SECS_PER_DAY) + RX_WINDOW * 60L;
 }
 
-volatile long lastMovementTime;
-void wakeUp() {
-  lastMovementTime = millis();
+boolean syncOverdue() {
+  if (lastSync == 0) return millis() / 1000 > syncLimit();
+  return (uint32_t)(now() - lastSync) > syncLimit();
+}
+
+// Hand a frame to the clock, to the millisecond while the decoder is
+// locked to the second marks
+void referenceClock(time_t utc) {
+  time_t phaseUtc;
+  uint32_t sinceSecond;
+  if (DCF.getUTCPhase(phaseUtc, sinceSecond)) {
+    ClockDiscipline::reference(phaseUtc, sinceSecond, true);
+  } else {
+    ClockDiscipline::reference(utc, 0, false);
+  }
+  setTime(ClockDiscipline::now());
+}
+
+// What the decoder learned, kept in the RTC RAM across a reset
+void saveSyncState() {
+  DCF77State learned;
+  DCF.state(learned);
+  SyncState::save(rtc, learned);
+}
+
+void startReception() {
+  #ifdef dcfPonPin
+    digitalWrite(dcfPonPin, LOW);
+  #endif
+  DCF.Start();
+  receiving = true;
+  confirming = false;
+  receptionStart = millis();
+  TELEMETRY_EVENT(TelemetryReception, TelemetryRxStart, 0);
+}
+
+// why: TelemetryRx*, what ended the reception
+void stopReception(byte why) {
+  TELEMETRY_EVENT(TelemetryReception, why, millis() - receptionStart);
+  DCF.Stop();
+  // Done: saved with the frame already
+  if (why != TelemetryRxDone) saveSyncState();
+  #ifdef dcfPonPin
+    digitalWrite(dcfPonPin, HIGH);
+  #endif
+  receiving = false;
+}
+
+// Seconds until the next reception window opens, 0 while one is open and
+// no frame was accepted in it yet. A window is skipped when the clock can
+// still wait for the next one, or when it was closed early.
+uint32_t secondsToReception() {
+  long today = localNow().secondsToday();
+  uint32_t next = SECS_PER_DAY;
+  uint32_t since = now() - lastSync;
+  boolean due = lastSync == 0 ||
+                since + SECS_PER_DAY / sizeof(receptionHours) >= ClockDiscipline::syncGap();
+  for (byte i = 0; i < sizeof(receptionHours); i++) {
+    long until = receptionHours[i] * (long)SECS_PER_HOUR - today;
+    if (until <= 0 && -until < RX_WINDOW * 60L) {
+      boolean closed = windowClosedAt != 0 && now() + until <= windowClosedAt;
+      if (due && !closed && since >= RX_WINDOW * 60UL) return 0;
+    }
+    if (until <= 0) until += SECS_PER_DAY;
+    if ((uint32_t)until < next) next = until;
+  }
+  return next;
+}
+
+void keepAlive() {
+  digitalWrite(keepAlivePin, HIGH);
+  // delayMicroseconds() needs no timer, it also works right after a
+  // power-down wake-up
+  for (byte i = 0; i < KEEPALIVE_MS; i++) delayMicroseconds(1000);
+  digitalWrite(keepAlivePin, LOW);
+}
+
+// Power down until someone shows up or the next reception window opens.
+// The square wave wakes the MCU every second to count down and pulse the
+// keep-alive. INT1 edges do not wake a powered down AVR, so the PIR is
+// read on those wake-ups too.
+void dormant() {
+  uint32_t left = secondsToReception();
+  uint32_t last = RtcWake::seconds();
+  uint32_t slept = 0;
+  #if KEEPALIVE_EVERY
+    uint32_t sinceKeepAlive = 0;
+  #endif
+  power_all_disable();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  while (slept < left && !digitalRead(pirPin)) {
+    cli();
+    if (RtcWake::seconds() == last) {
+      sleep_enable();
+      sei();
+      sleep_cpu();
+      sleep_disable();
+    }
+    sei();
+    uint32_t seconds = RtcWake::seconds();
+    slept += seconds - last;
+    #if KEEPALIVE_EVERY
+      sinceKeepAlive += seconds - last;
+      if (sinceKeepAlive >= KEEPALIVE_EVERY) {
+        keepAlive();
+        sinceKeepAlive = 0;
+      }
+    #endif
+    last = seconds;
+  }
+  power_all_enable();
+  ClockDiscipline::resume();
+  setTime(ClockDiscipline::now());
+  if (digitalRead(pirPin)) wakeUp();
+}
+
+// DCF77 interrupt: a frame is queued
+void frameReady() {
+  tasks.signal(frameEvent);
 }
 
 void goToSleep() {
@@ -153,8 +374,9 @@ void goToSleep() {
   // Processor wakes up here after ISR
   sleep_disable();
   power_all_enable();
-  setTime(dateTimeToTime_t(rtc.now()));
-  DCF.Start();
+  ClockDiscipline::resume();
+  setTime(ClockDiscipline::now());
+  startReception();
 }
 
 enum clockStatusT {main, showDCF, other};
@@ -195,60 +417,85 @@ int myButton() {
   } else return 0;
 }
 
-void setup() {
-  #ifdef VERBOSE_DEBUG
-    Serial.begin(9600);
-  #endif
-  pinMode(LED1, OUTPUT);
-  pinMode(LED2, OUTPUT);
-  digitalWrite(LED1, 0);
-  digitalWrite(LED2, 0);
-  delay(1000);
+boolean displayOff = false;
+clockStatusT clockStatus = main;
+int fidelioBrightness = 7;
+
+// Awake and receiver time per local day. millis() stands still while
+// powered down, so its advance is the time the MCU ran.
+struct PowerDay {
+  uint32_t awakeMs;
+  uint32_t receiveMs;
+};
+PowerDay powerToday, powerYesterday;
+
+void accountPower() {
+  static uint32_t lastMillis = 0;
+  static byte today = 0;
+  uint32_t ms = millis();
+  powerToday.awakeMs += ms - lastMillis;
+  if (receiving) powerToday.receiveMs += ms - lastMillis;
+  lastMillis = ms;
+  byte d = localNow().day();
+  if (d != today) {
+    if (today != 0) {
+      powerYesterday = powerToday;
+      DEBUG("Awake s/day: ");
+      DEBUG_LN(powerYesterday.awakeMs / 1000);
+    }
+    powerToday.awakeMs = powerToday.receiveMs = 0;
+    today = d;
+  }
+}
 
-  pinMode(pirPin, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(pirPin), wakeUp, RISING);
-  
-  DCF.Start();
-  setSyncProvider(DCF.getUTCTime);
+void printPowerDay(Print &out, const PowerDay &p) {
+  out.print(F(" awake "));
+  out.print(p.awakeMs / 1000);
+  out.print(F(" s rx "));
+  out.print(p.receiveMs / 1000);
+  out.print(F(" s"));
+}
 
-  #ifdef FIDELIODISPLAY_h
-    display.init();
-    display.cls();
-    display.setBright(7);
+// Serial commands: 'p' prints the CPU profile since the previous query
+// and the awake time of today and yesterday, 'q' the reception statistics
+void serialCommand() {
+  #if defined(CPU_PROFILE) || defined(VERBOSE_DEBUG)
+    while (Serial.available()) {
+      char command = Serial.read();
+      #ifdef CPU_PROFILE
+        if (command == 'p') {
+          CpuProfile::report(Serial);
+          Serial.print(F("today"));
+          printPowerDay(Serial, powerToday);
+          Serial.print(F(", yesterday"));
+          printPowerDay(Serial, powerYesterday);
+          Serial.println();
+        }
+      #endif
+      if (command == 'q') DCF.statistics().report(Serial);
+    }
   #endif
+}
 
-  if (! rtc.begin()) {
-    DEBUG_LN("Could not find RTC");
-  }
-
-  if (! rtc.isrunning()) {
-    DEBUG_LN("RTC is NOT running, let's set the time!");
-
-    setSyncInterval(30);
+void serviceSerial() {
+  #ifdef DCF_CAPTURE
+    DCF.flushCapture();
+  #endif
+  #ifdef DCF_VERBOSE_DEBUG
+    DCF.flushLog();
+  #endif
+  #ifdef TELEMETRY
+    Telemetry::flush();
+  #endif
+  serialCommand();
+}
 
-    DEBUG_LN("Waiting for DCF77 time ... ");
-    DEBUG_LN("It will take at least 2 minutes until a first update can be processed.");
-    while(timeStatus()== timeNotSet) { 
-      showSyncProcess();
-      delay(250);
-    }
-    rtc.adjust(time_tToDateTime(now()));
-    DEBUG_LN("Updated ATmega to DCF") ;
-  } else {
-    setTime(dateTimeToTime_t(rtc.now()));
-    DEBUG_LN("Updated ATmega to RTC") ;
-  }
-  setSyncInterval(180);
+void animate() {
+  animator.tick(millis());
 }
 
-void loop() {
-  static boolean displayOff = false; 
-  static time_t prevDisplay = 0;          // when the digital clock was displayed
+void readLight() {
   static int lastBrightness = -1;
-  static clockStatusT clockStatus = main;
-  static int fidelioBrightness = 7;
-  int currentPIRState = digitalRead(pirPin);
-
   #define maxLight 300
   int currentBrightness = analogRead(lightPin);
   currentBrightness = constrain(currentBrightness, 0, maxLight);
@@ -256,86 +503,284 @@ void loop() {
     lastBrightness = currentBrightness;
     fidelioBrightness = map(maxLight-currentBrightness, 0, maxLight, 0, 8);
   }
-  
+}
+
+void scanButtons() {
   int button = myButton();
   if (button > 0) {
     // DEBUG_LN(); DEBUG("Pressed: ");     DEBUG_LN(button);
-    // digitalWrite(LED_BUILTIN, (digitalRead(LED_BUILTIN) ^ 1));
-    // if (1 == button || 2 == button || 3 == button || 4 == button) {
-    //   digitalWrite(LED1, (digitalRead(LED1) ^ 1));
-    //   // analogWrite(LED1, analogRead(A0)/4);
-    // } // else analogWrite(LED1, 0);
+    if (1 == button && clockStatus == main) {
+      animator.rotate(datePages, 2, 2000);
+    }
     if (2 == button) {
       clockStatus = (clockStatus == showDCF ? main:showDCF);
+      // Showing the reception starts it between the scheduled windows
+      if (clockStatus == showDCF && !receiving) startReception();
+    }
+  }
+}
+
+// An announcement only counts once two frames in a row carry it: a
+// scheduled window waits for another frame while the last one carried an
+// announcement not confirmed yet, or while one is due at the end of this
+// hour, a zone change by the rules or a leap second at the end of June or
+// December
+boolean awaitConfirmation(time_t utc) {
+  if (DCF.pendingAnnouncements()) return true;
+  if (DCF.getFlags() & DCFFlagAnnouncements) return false;
+  time_t hourEnd = utc - utc % SECS_PER_HOUR + SECS_PER_HOUR;
+  if (localNow().nextChange() <= hourEnd) return true;
+  return day(hourEnd) == 1 && hour(hourEnd) == 0 && (month(hourEnd) == 1 || month(hourEnd) == 7);
+}
+
+// Frame event: the decoder hands out the time once per accepted frame.
+// Local time follows the transmitted offset, and announced changes and
+// leap seconds happen at their hour. A scheduled reception is done with
+// the first frame, or the second, see awaitConfirmation().
+void collectFrame() {
+  time_t utc = DCF.getUTCTime();
+  if (utc != 0) {
+    referenceClock(utc);
+    lastSync = utc;
+    byte flags = DCF.getFlags();
+    TELEMETRY_EVENT(TelemetrySync, flags, utc);
+    saveSyncState();
+    CET.transmitted(utc, DCF.utcOffset(), flags & DCFFlagCEST, flags & DCFFlagZoneChange ? DCF.announcedAt() : 0);
+    if (flags & DCFFlagLeapSecond) ClockDiscipline::leapSecond(DCF.announcedAt());
+    if (clockStatus == showDCF) {
+      DEBUG_LN("Time updated to DCF");
+      clockStatus = main;
+    }
+    if (scheduledReception && !confirming && awaitConfirmation(utc)) {
+      confirming = true;
+      DEBUG_LN("Waiting for a second frame");
+    } else if (scheduledReception) {
+      stopReception(TelemetryRxDone);
+      DEBUG_LN("Reception done");
     }
   }
+}
+
+// Open a reception window at the listed hours, close it after RX_WINDOW
+// minutes when no frame came, or after RX_GIVE_UP when the signal is too
+// poor to hope for one
+void scheduleReception() {
+  if (!receiving) {
+    if (secondsToReception() == 0) startReception();
+  } else if (millis() - receptionStart >= RX_WINDOW * 60000UL) {
+    stopReception(TelemetryRxTimeout);
+    // Waiting for a second frame, the window had its first
+    if (!confirming) windowClosedAt = now();
+    DEBUG_LN("Reception timed out");
+  } else if (millis() - receptionStart >= RX_GIVE_UP * 60000UL && DCF.quality() < RX_MIN_QUALITY) {
+    stopReception(TelemetryRxGiveUp);
+    windowClosedAt = now();
+    DEBUG_LN("Reception given up, no signal");
+  }
+}
+
+#ifdef TELEMETRY
+  // Reception statistics once a minute while the receiver is on
+  void reportReception() {
+    if (!receiving) return;
+    TELEMETRY_EVENT(TelemetryQuality, DCF.quality(), DCF.statistics().rate());
+    TELEMETRY_EVENT(TelemetryJitter, DCF.secondLocked(), DCF.secondJitter());
+    TELEMETRY_EVENT(TelemetryPeriod, 0, DCF.secondPeriod());
+    PulseClassifier::Parameters pulses;
+    DCF.pulseParameters(pulses);
+    TELEMETRY_EVENT(TelemetryPulses,
+                    (pulses.learned ? TelemetryPulseLearned : 0) | (pulses.inverted ? TelemetryPulseInverted : 0),
+                    pulses.shortWidth | (uint32_t)pulses.longWidth << 16);
+    TELEMETRY_EVENT(TelemetryPulseLimits, pulses.minWidth > 255 ? 255 : pulses.minWidth,
+                    pulses.split | (uint32_t)pulses.maxWidth << 16);
+  }
+#endif
+
+// Follow the RTC between frames and hand each new second to the Time
+// library, which the rest of the sketch reads
+void trackClock() {
+  static time_t last = 0;
+  ClockDiscipline::track();
+  time_t t = ClockDiscipline::now();
+  if (t != last) {
+    last = t;
+    setTime(t);
+  }
+}
 
+// PIR interrupt: someone is around
+void motionSeen() {
+  if (displayOff) animator.fade(0, fidelioBrightness);
+  displayOff = false;
+  // DEBUG_LN("Turn display ON");
+}
+
+// Nobody around for STAYON: display off, or sleep until the PIR wakes us
+void checkPresence() {
+  noInterrupts();
+  long moved = lastMovementTime;
+  interrupts();
+  if (digitalRead(pirPin) || abs(millis() - moved) <= STAYON) return;
+  if (scheduledReception) {
+    if (!displayOff) {
+      displayOff = true;
+      display.cls();
+      display.Off();
+    }
+    if (!receiving) dormant();
+  } else if (displayOff) {
+    return;
+  } else if (trueSleep) {
+    DEBUG_LN("Going sleep");
+    display.Off();
+    stopReception(TelemetryRxSleep);
+    delay(100);
+    goToSleep();
+    delay(500);
+    DEBUG_LN("Waking up");
+  } else {
+    displayOff = true;
+    display.cls();
+    display.Off();
+    // DEBUG_LN("Turn display OFF");
+  }
+}
+
+void updateDisplay() {
+  static time_t prevDisplay = 0;          // when the digital clock was displayed
   switch (clockStatus)  {
       case main:
         if(now() != prevDisplay) { //update the display only if the time has changed
           prevDisplay = now();
           
-          if (!displayOff) {
+          if (!displayOff && !animator.busy()) {
             // digitalClockDisplay();
-            time_t LocalTime = CET.toLocal(now());
-            intToTimeString(timetxt, hour(LocalTime), minute(LocalTime));
-            display.setBright(fidelioBrightness);
+            const LocalClock &local = localNow();
+            if (!animator.fading()) display.setBright(fidelioBrightness);
             // DEBUG_LN(); DEBUG("Level: "); DEBUG_LN(fidelioBrightness);
             // DEBUG("TS:");
             // DEBUG_LN(timeStatus());
-            display.alarm( (timeStatus() != timeSet) );
-            display.pm(!DCF.bufOk);
+            display.alarm(syncOverdue());
+            display.pm(!shownReceiver().bufOk);
             display.toogleDots(); 
-            display.write(timetxt);
+            display.printTime(local.hour(), local.minute());
           } 
-          int delta = now() - dateTimeToTime_t(rtc.now());
-          if ( 0 != delta ) {
-            if (timeStatus() == timeSet && DCF.bufOk) {
-              rtc.adjust(time_tToDateTime(now()));
-              DEBUG_LN();
-              DEBUG("Updated RTC to DCF77 by: ") ;
-              DEBUG_LN(delta);
-            } else {
-              setTime(dateTimeToTime_t(rtc.now()));
-              DEBUG_LN();
-              DEBUG("Updated ATmega to RTC by: ") ;        
-              DEBUG_LN(delta) ;
-            }
-          }
+          checkPresence();
         }
-        if (!currentPIRState && (abs(millis() - lastMovementTime)  > STAYON) ) {
-          if (trueSleep) {
-            DEBUG_LN("Going sleep");
-            display.Off();
-            DCF.Stop();
-            delay(100);
-            goToSleep();
-            delay(500);
-            DEBUG_LN("Waking up");
-            displayOff = false;
-          } else {
-            displayOff = true;
-            display.cls();
-            display.Off();
-            // DEBUG_LN("Turn display OFF");
-          }
-        } else {
-          displayOff = false;
-          // DEBUG_LN("Turn display ON");
-        }
-        // DEBUG_LN(); DEBUG("Status 0: "); DEBUG_LN(clockStatus);
         break;
       case showDCF:
-        //DEBUG_LN(); DEBUG("Status 1: "); DEBUG_LN(clockStatus);
         display.setBright(fidelioBrightness);
         showSyncProcess();
-        if (timeStatus() == timeSet && DCF.bufOk) { 
-          rtc.adjust(time_tToDateTime(now()));
-          DEBUG_LN("Time updated to DCF");
-          clockStatus = main;
-        }
         break;
       default:
         break;
   }
-}
\ No newline at end of file
+}
+
+void setup() {
+  #if defined(VERBOSE_DEBUG) || defined(DCF_VERBOSE_DEBUG) || defined(DCF_CAPTURE) || defined(CPU_PROFILE) || defined(TELEMETRY)
+    Serial.begin(9600);
+  #endif
+  pinMode(LED1, OUTPUT);
+  pinMode(LED2, OUTPUT);
+  digitalWrite(LED1, 0);
+  digitalWrite(LED2, 0);
+  delay(1000);
+
+  pinMode(pirPin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(pirPin), wakeUp, RISING);
+  #ifdef dcfPonPin
+    pinMode(dcfPonPin, OUTPUT);
+  #endif
+  #if KEEPALIVE_EVERY
+    pinMode(keepAlivePin, OUTPUT);
+  #endif
+
+  startReception();
+
+  #ifdef FIDELIODISPLAY_h
+    display.init();
+    display.cls();
+    display.setBright(7);
+  #endif
+
+  boolean rtcFound = rtc.begin();
+  if (!rtcFound) {
+    DEBUG_LN("Could not find RTC");
+    #ifdef FIDELIODISPLAY_h
+      display.print(errText);
+      delay(2000);
+    #endif
+  }
+
+  // Reception started above; what it learned before the reset helps it on
+  DCF77State learned;
+  if (rtcFound && SyncState::load(rtc, learned)) DCF.restore(learned);
+
+  boolean rtcRunning = rtc.isrunning();
+  TELEMETRY_EVENT(TelemetryStart, (rtcFound ? TelemetryRtcFound : 0) | (rtcRunning ? TelemetryRtcRunning : 0),
+            TelemetryVersion);
+  if (!rtcRunning) {
+    DEBUG_LN("RTC is NOT running, let's set the time!");
+    #ifdef FIDELIODISPLAY_h
+      display.print(rtcText);
+      delay(2000);
+    #endif
+
+    DEBUG_LN("Waiting for DCF77 time ... ");
+    DEBUG_LN("It will take at least 2 minutes until a first update can be processed.");
+    ClockDiscipline::begin(rtc);
+    time_t utc;
+    while ((utc = DCF.getUTCTime()) == 0) {
+      #ifdef DCF_CAPTURE
+        DCF.flushCapture();
+      #endif
+      #ifdef DCF_VERBOSE_DEBUG
+        DCF.flushLog();
+      #endif
+      #ifdef TELEMETRY
+        Telemetry::flush();
+      #endif
+      showSyncProcess();
+      delay(250);
+    }
+    // The RTC is set from the first frame with the second phase
+    referenceClock(utc);
+    lastSync = utc;
+    DEBUG_LN("Updated ATmega to DCF") ;
+  } else {
+    ClockDiscipline::begin(rtc);
+    setTime(ClockDiscipline::now());
+    DEBUG_LN("Updated ATmega to RTC") ;
+  }
+  if (scheduledReception) RtcWake::begin(rtc, sqwPin);
+
+  tasks.every(SERIAL_PERIOD, serviceSerial);
+  tasks.every(ANIMATE_PERIOD, animate);
+  tasks.every(LIGHT_PERIOD, readLight);
+  tasks.every(BUTTON_PERIOD, scanButtons);
+  tasks.every(DISPLAY_PERIOD, updateDisplay);
+  tasks.every(TRACK_PERIOD, trackClock);
+  frameEvent = tasks.on(collectFrame);
+  motionEvent = tasks.on(motionSeen);
+  tasks.every(POWER_PERIOD, accountPower);
+  if (scheduledReception) tasks.every(POWER_PERIOD, scheduleReception);
+  #if KEEPALIVE_EVERY
+    tasks.every(KEEPALIVE_EVERY * 1000U, keepAlive);
+  #endif
+  #ifdef TELEMETRY
+    tasks.every(MINUTE_PERIOD, reportReception);
+  #endif
+  DCF.onFrame(frameReady);
+}
+
+
+// Everything runs as a task; between them the MCU sleeps
+void loop() {
+  {
+    PROFILE_SCOPE(PROFILE_LOOP);
+    TELEMETRY_LOOP_SCOPE();
+    tasks.dispatch();
+  }
+  tasks.idle();
+}